@@ -11,6 +11,9 @@
  *  	Dès que le caclul est rendu dans le segment de mémoire partagée,
  *  	par le processus serveur, le processus client l'affiche et
  *  	s'arrête.
+ *  	Les données sont déposées par blocs après l'envoi de la requête:
+ *  	le worker calcule chaque bloc dès qu'il est déposé et le client
+ *  	récupère les blocs calculés pendant qu'il dépose les suivants.
  *  	La requête est constituée:
  *  	    ---> du pid (id du processus) du processus client
  *  	    ---> du numéro de l'opération de calcul demandée
@@ -26,6 +29,23 @@
  *  	On prévoi deux manière pour indiquer la source de données:
  *  	    ---> en ligne de dommande (indication du fichier de données)
  *  	    ---> via le fichier de configuration
+ *
+ *  	Les opérations des plugins du serveur sont connues grâce au catalogue
+ *  	qu'il publie (CATALOGUE_OPERATIONS). Leurs éléments peuvent compter
+ *  	plusieurs entiers consécutifs du fichier de données.
+ *
+ *  	Mode flux : "./client -f <fichierEntrée> <opération> <fichierSortie>"
+ *  	lit le fichier par blocs et écrit le résultat dans un fichier, sans
+ *  	jamais charger tout le fichier en mémoire (voir flux.c). Ce mode est
+ *  	prévu pour les fichiers trop grands pour un segment de mémoire partagée.
+ *  	Il est local: le calcul est fait par le client lui-même, sans passer
+ *  	par le serveur, et n'accepte que les opérations associatives.
+ *
+ *  	Jeux de données nommés : "./client -d <nom> <fichier>" dépose une fois
+ *  	le fichier sur le serveur sous le nom indiqué, puis
+ *  	"./client -n <nom> <opération> [plan [nbThreads]]" calcule sur ce
+ *  	jeu sans retransférer les données: le segment de mémoire partagée
+ *  	du client ne reçoit que les résultats (voir datasets.c).
  */
 
 #include <unistd.h>
@@ -37,14 +57,32 @@
 #include <string.h>
 #include <fcntl.h>
 #include <errno.h>
+#include <sched.h>
+#include <signal.h>
+#include <time.h>
 #include "conf.h"
-
-int  lireData(int *data, int *nbValeurs, char *fichier);
+#include "flux.h"
+#include "planificateur.h"
+#include "operations.h"
+#include "plugins.h"
+#include "datasets.h"
+#include "controle.h"
+
+int  lireData(int **data, int *nbValeurs, char *fichier);
 void afficherData(int *tab, int size);
 void afficherErreurUsage();
 int  dataFileNotExiste(char *f);
 void afficherOperationsPossibles();
 void afficherErreurOperation();
+int  recupererResultats(struct shmseg *shmp, int *resultats, int taille, int dejaRecuperes);
+int  attendreResultats(struct shmseg *shmp, int *resultats, int taille, int dejaRecuperes);
+int  requeteAbandonnee(struct shmseg *shmp);
+struct shmseg *creerSegment(size_t taille, int *shmid);
+int  detruireSegment(struct shmseg *shmp, int shmid);
+int  envoyerRequete(struct requete *req);
+int  deposerDataset(char *nom, char *fichier);
+int  calculerDataset(char *nom, int operation, int plan, int nbThreads);
+int  operationDepuisArgument(const char *arg);
 
 /* ************************************************************************************/
 /*                          Programme principale du client                            */
@@ -55,12 +93,51 @@ int main(int argc, char *argv[]) {
 
     printf("==> PID du client : %d\n", getpid());
 
+    // un serveur arrêté entre l'ouverture du tube et l'écriture de la requête
+    // doit donner une erreur d'écriture, pas tuer le client
+    signal(SIGPIPE, SIG_IGN);
+
     // Etape 1 : Vérification et récupération des arguments fournis en ligne de commande
     // -----------------------------------------------------------------
 
     char *fichier = NULL;     // pDataFile : pointeur vers le fichier de données
 
-    if (argc != 3) {
+    // Mode flux : ./client -f <fichierEntrée> <opération> <fichierSortie>
+    // Le calcul est alors fait par le client, qui charge lui-même les plugins
+    if (argc == 5 && strcmp(argv[1], "-f") == 0) {
+        chargerPlugins(DOSSIER_PLUGINS);
+        int operation = operationDepuisArgument(argv[3]);
+        if (!operationExiste(operation)) {
+            afficherErreurOperation();
+            return EXIT_FAILURE;
+        }
+        return traitementFlux(argv[2], operation, argv[4]);
+    }
+
+    // Sinon, les opérations possibles sont celles publiées par le serveur
+    lireCatalogue(CATALOGUE_OPERATIONS);
+
+    // Dépôt d'un jeu de données nommé : ./client -d <nom> <fichier>
+    if (argc == 4 && strcmp(argv[1], "-d") == 0) {
+        return deposerDataset(argv[2], argv[3]);
+    }
+
+    // Calcul sur un jeu déposé : ./client -n <nom> <opération> [plan [nbThreads]]
+    if (argc >= 4 && argc <= 6 && strcmp(argv[1], "-n") == 0) {
+        int operation = operationDepuisArgument(argv[3]);
+        if (!operationExiste(operation)) {
+            afficherErreurOperation();
+            return EXIT_FAILURE;
+        }
+        int plan = (argc >= 5) ? planDepuisNom(argv[4]) : PLAN_AUTO;
+        if (plan < 0) {
+            afficherErreurUsage();
+            return EXIT_FAILURE;
+        }
+        return calculerDataset(argv[2], operation, plan, (argc == 6) ? atoi(argv[5]) : 0);
+    }
+
+    if (argc < 3 || argc > 5) {
         afficherErreurUsage();  // si l'utilisateur ne donne pas le nom du fichier et le
         return EXIT_FAILURE;    // numéro de l'opération, on lui affiche une erreur d'usage
                                 //  ./client <nomFichierDeDonnées> <numéro opération>
@@ -70,24 +147,39 @@ int main(int argc, char *argv[]) {
                                 // fourni en ligne de commande
 
     int operation;              // opération de calcul à réaliser par les workers
-    operation = atoi(argv[2]);  // On récupère le numéro de l'opération à effectuer sur
-                                // les données
+    operation = operationDepuisArgument(argv[2]);   // On récupère le numéro (ou le nom) de
+                                                    // l'opération à effectuer sur les données
 
-    if (operation <1 || operation>NB_OPERATIONS) {  // on vérifier le numéro de l'opération
+    if (!operationExiste(operation)) {              // on vérifier le numéro de l'opération
                                                     // Indiquée en ligne de commande
         afficherErreurOperation();                  // si non prévue on affiche un message
         return EXIT_FAILURE;                        // d'erreur et on quite le programme
     }
 
+    // Arguments optionnels : le plan d'exécution et le nombre de threads imposés
+    // au serveur. Par défaut c'est le planificateur du serveur qui les choisit.
+    int plan = PLAN_AUTO;
+    int nbThreads = 0;
+    if (argc >= 4) {
+        plan = planDepuisNom(argv[3]);
+        if (plan < 0) {
+            afficherErreurUsage();
+            return EXIT_FAILURE;
+        }
+    }
+    if (argc == 5) {
+        nbThreads = atoi(argv[4]);
+    }
+
     // ---------------------------------------------------------------------
     // Etape 2 : Récupération des données depuis le fichier dont le nom est
     // fourni en ligne de commande ce fichier comporte un tableau de valeurs
     // ---------------------------------------------------------------------
 
-    int data[NB_MAX_VALEURS];   // tableau de données
+    int *data = NULL;           // tableau de données (alloué par lireData)
     int nbDataValues = 0;       // nombre d'éléments dans le tableau de données
 
-    if(lireData(data, &nbDataValues, fichier)==EXIT_FAILURE) {
+    if(lireData(&data, &nbDataValues, fichier)==EXIT_FAILURE) {
         printf("Erreur dans le fichier de données");
         return EXIT_FAILURE;
     }
@@ -96,6 +188,15 @@ int main(int argc, char *argv[]) {
     printf("\n==> %d valeurs lues à partir du fichier %s :\n\n    ", nbDataValues, fichier);
     afficherData(data, nbDataValues);
 
+    // Pour les opérations des plugins, un élément peut compter plusieurs valeurs
+    int taille = tailleElement(operation);
+    if (nbDataValues % taille != 0) {
+        printf("\nL'opération %s attend des éléments de %d valeurs: ", descripteurOperation(operation)->nom, taille);
+        printf("le nombre de valeurs du fichier doit en être un multiple\n");
+        free(data);
+        return EXIT_FAILURE;
+    }
+
     // --------------------------------------------------
     // Etape 3 : Création d'un segment de mémoire partagé
     // --------------------------------------------------
@@ -103,83 +204,72 @@ int main(int argc, char *argv[]) {
     int shmid;              // id du segment de mémoire partagée
     struct shmseg *shmp;    // pointeur vers le segment de mémoire partagé
 
-    /* Obtention de l'identifiant du segment de mémoire partagée
-       grâce la l'appel de "shmget" à laquelle il faut indiquer une clé unique
-       ici on se servira du pid du processus on indiquera la taille de la zone
-       à obtenir et les droits d'accès à cette zone.
-       le paramètre IPC_CREAT est pour créer un nouveau segment.*/
-
-    shmid = shmget((int)getpid(), sizeof(struct shmseg), 0644 | IPC_CREAT);
-
-    if (shmid == -1) {
-        perror("Shared memory");
-        return 1;
-    }
-
-    /* Attacher le segment de mémoire partagé à l'espace d'adressage du processus
-       en cours afin que ce dernier puisse y accéder.
-       L'appel à la fonction "shmat" (shared mémory attach) va renvoyer un pointeur
-       vers le segment de mémoire partagée. "shmat exige de lui fournir la clé du
-       segment de mémoire partagé renvoyé par la fonction shmget */
-
-    shmp = shmat(shmid, NULL, 0);
-    if (shmp == (void*) -1) {
-        perror("Shared memory attach");
+    shmp = creerSegment(TAILLE_SEGMENT(nbDataValues), &shmid);
+    if (shmp == NULL) {
+        free(data);
         return 1;
     }
 
-    // -------------------------------------------------------------------
-    // Etape 4 : Transfert des données vers le segment de mémoire partagée
-    // -------------------------------------------------------------------
-
-    for (int i = 0; i < nbDataValues; i++) {
-        shmp->data[i] = data[i];
-    }
-
-    printf("\n==> %d valeurs ont été écrites en mémoire partagée\n", nbDataValues);
-
-    shmp->status = FIN_DEPOT_DATA;
-
     // ---------------------------------------------------------------------
-    // Etape 5 : Création d'une requête. On met 3 champs : le PID du client,
-    // la taille du tableau de données et l'opération qui doit être appliqué
-    // par les workers sur les données
+    // Etape 4 : Création d'une requête. On met le PID du client, la taille
+    // du tableau de données, l'opération qui doit être appliqué par les
+    // workers sur les données et le plan d'exécution éventuellement imposé
     // ---------------------------------------------------------------------
 
+    int nbElements = nbDataValues / taille;
+
     struct requete req;
-    req.dataSize  = nbDataValues;
+    req.type      = REQUETE_CALCUL;
+    req.dataSize  = nbElements;                // nombre d'éléments
     req.operation = operation;
     req.pid       = getpid();
+    req.plan      = plan;
+    req.nbThreads = nbThreads;
 
-    // ------------------------------------------------------------
-    // Etape 6 : Tentative d'ouverture en écriture du tube de
-    // communication partagé avec le seveur afin de lui transmettre
-    // une requête. Si echec --> message d'erreur et quitter
-    // ------------------------------------------------------------
+    // ----------------------------------------------------------------
+    // Etape 5 et 6 : Ecriture de la requete dans le tube partagé avec
+    // le serveur, avant le dépôt des données: le worker commence à
+    // calculer dès le premier bloc déposé
+    // ----------------------------------------------------------------
 
-    int fdwrite;
-    if ((fdwrite = open(FIFO_NAME, O_WRONLY)) == -1) {
-        printf("\n\nImpossible d'ouvrir le tube en écriture: %s\n",
-               strerror(errno));
+    shmp->status = DEBUT_DEPOT_DATA;
+
+    if (envoyerRequete(&req) == EXIT_FAILURE) {
+        detruireSegment(shmp, shmid);
         exit(EXIT_FAILURE);
     }
 
-    // ---------------------------------------------
-    // Etape 7 : Ecriture de la requete dans le tube
-    // ---------------------------------------------
-
-    if (write(fdwrite, &req, sizeof(req))>0) {
-        printf("\n==> La requête du client est écrite avec success dans le tube\n ");
+    // --------------------------------------------------------------------
+    // Etape 7 : Transfert des données vers le segment de mémoire partagée
+    // par blocs de TAILLE_BLOC_PIPELINE éléments. Entre deux blocs, on
+    // récupère les résultats déjà rendus par le worker. Le tableau "data"
+    // reçoit les résultats à la place des données déjà déposées.
+    // --------------------------------------------------------------------
+
+    int nbRecuperes = 0;
+    for (int premier=0; premier<nbElements; premier+=TAILLE_BLOC_PIPELINE) {
+        int nb = (nbElements - premier < TAILLE_BLOC_PIPELINE) ? nbElements - premier : TAILLE_BLOC_PIPELINE;
+        memcpy(&shmp->data[premier*taille], &data[premier*taille], (size_t)nb * taille * sizeof(int));
+        __atomic_store_n(&shmp->nbDeposes, premier + nb, __ATOMIC_RELEASE);
+        nbRecuperes = recupererResultats(shmp, data, taille, nbRecuperes);
     }
 
+    printf("\n==> %d valeurs ont été écrites en mémoire partagée\n", nbDataValues);
+
+    // pas de FIN_DEPOT_DATA: le worker sait que le dépôt est fini par
+    // nbDeposes, et a peut-être déjà rendu son statut final
+
     // ----------------------------------------------------------
-    // Etape 8 : Boucle d'attente des la fin du calcul du côté du
-    // serveur et de la remise du résultat par les workers
+    // Etape 8 : Boucle de récupération des derniers blocs calculés
+    // et d'attente de la remise du résultat par les workers
     // ----------------------------------------------------------
 
     printf("\n==> Attente de la remise du résultat par les workers (serveur)...\n");
-    while (shmp->status == FIN_DEPOT_DATA) {
-        continue;
+    if (attendreResultats(shmp, data, taille, nbRecuperes) == ERREUR_REQUETE) {
+        printf("\n==> Requête refusée par le serveur\n");
+        free(data);
+        detruireSegment(shmp, shmid);
+        return EXIT_FAILURE;
     }
 
     // -------------------------------
@@ -187,13 +277,112 @@ int main(int argc, char *argv[]) {
     // -------------------------------
 
     printf("\n==> Traitelent du coté serveur terminé. Voici le résultat:\n\n    ");
-    afficherData(shmp->data, nbDataValues);
+    afficherData(data, nbDataValues);
+    printf("\n==> Plan d'exécution retenu : %s, %d thread(s), calcul en %lld µs\n",
+           nomPlan(shmp->plan), shmp->nbThreads, shmp->dureeCalcul / 1000);
     printf("\n");
+    free(data);
 
     // ---------------------------------------------------
     // Etape 10 : Détacher le segment de mémoire partagée
     // ---------------------------------------------------
 
+    return detruireSegment(shmp, shmid);
+}
+/*                                Fin du programme principal                          */
+/* ************************************************************************************/
+
+/* Implémentation de quelques fonctions utiles */
+/***********************************************/
+
+// copie dans "resultats" des éléments calculés par le worker depuis le
+// dernier appel et renvoi du nombre total d'éléments récupérés
+int recupererResultats(struct shmseg *shmp, int *resultats, int taille, int dejaRecuperes) {
+    int nbCalcules = __atomic_load_n(&shmp->nbCalcules, __ATOMIC_ACQUIRE);
+    if (nbCalcules > dejaRecuperes) {
+        memcpy(&resultats[dejaRecuperes*taille], &shmp->data[dejaRecuperes*taille],
+               (size_t)(nbCalcules - dejaRecuperes) * taille * sizeof(int));
+        return nbCalcules;
+    }
+    return dejaRecuperes;
+}
+
+// le worker de la requête est-il encore là? Avant sa prise en charge, la
+// requête peut attendre dans le tube aussi longtemps que le serveur est
+// occupé (voir "regler workers"): elle n'est abandonnée que si le serveur
+// ne répond plus sur son canal de contrôle
+int requeteAbandonnee(struct shmseg *shmp) {
+    int pidWorker = __atomic_load_n(&shmp->pidWorker, __ATOMIC_ACQUIRE);
+    if (pidWorker == 0) {
+        if (serveurJoignable(SOCKET_CONTROLE)) return FALSE;
+        printf("\n==> Le serveur s'est arrêté avant de prendre la requête en charge\n");
+        return TRUE;
+    }
+    if (kill(pidWorker, 0) == -1 && errno == ESRCH) {
+        printf("\n==> Le worker %d s'est arrêté sans rendre le résultat\n", pidWorker);
+        return TRUE;
+    }
+    return FALSE;
+}
+
+// attente de la remise du résultat en récupérant les derniers blocs
+// calculés; renvoi du statut final (FIN_REMISE_RESULTATS ou ERREUR_REQUETE)
+int attendreResultats(struct shmseg *shmp, int *resultats, int taille, int dejaRecuperes) {
+    int status;
+    long tours = 0;
+    time_t derniereVerification = time(NULL);
+    while ((status = __atomic_load_n(&shmp->status, __ATOMIC_ACQUIRE)) != FIN_REMISE_RESULTATS
+           && status != ERREUR_REQUETE) {
+        int avant = dejaRecuperes;
+        dejaRecuperes = recupererResultats(shmp, resultats, taille, dejaRecuperes);
+        if (dejaRecuperes != avant) continue;
+        if (++tours % 100000 == 0 && time(NULL) != derniereVerification) {
+            derniereVerification = time(NULL);  // au plus une vérification par seconde
+            if (requeteAbandonnee(shmp)) {
+                // le statut a pu être rendu juste avant la fin du worker
+                status = __atomic_load_n(&shmp->status, __ATOMIC_ACQUIRE);
+                if (status != FIN_REMISE_RESULTATS) return ERREUR_REQUETE;
+                break;
+            }
+        }
+        sched_yield();
+    }
+    if (status == FIN_REMISE_RESULTATS) recupererResultats(shmp, resultats, taille, dejaRecuperes);
+    return status;
+}
+
+// création et attachement d'un segment de mémoire partagée de "taille" octets,
+// renvoi d'un pointeur vers ce segment ou NULL
+struct shmseg *creerSegment(size_t taille, int *shmid) {
+    /* Obtention de l'identifiant du segment de mémoire partagée
+       grâce la l'appel de "shmget" à laquelle il faut indiquer une clé unique
+       ici on se servira du pid du processus on indiquera la taille de la zone
+       à obtenir (fonction du nombre de valeurs) et les droits d'accès à cette zone.
+       le paramètre IPC_CREAT est pour créer un nouveau segment.*/
+
+    *shmid = shmget((int)getpid(), taille, 0644 | IPC_CREAT);
+
+    if (*shmid == -1) {
+        perror("Shared memory");
+        return NULL;
+    }
+
+    /* Attacher le segment de mémoire partagé à l'espace d'adressage du processus
+       en cours afin que ce dernier puisse y accéder.
+       L'appel à la fonction "shmat" (shared mémory attach) va renvoyer un pointeur
+       vers le segment de mémoire partagée. "shmat exige de lui fournir la clé du
+       segment de mémoire partagé renvoyé par la fonction shmget */
+
+    struct shmseg *shmp = shmat(*shmid, NULL, 0);
+    if (shmp == (void*) -1) {
+        perror("Shared memory attach");
+        return NULL;
+    }
+    return shmp;
+}
+
+// détachement et destruction du segment de mémoire partagée
+int detruireSegment(struct shmseg *shmp, int shmid) {
     if (shmdt(shmp) == -1) {
         perror("shmdt");
         return 1;
@@ -203,39 +392,177 @@ int main(int argc, char *argv[]) {
         perror("shmctl");
         return 1;
     }
-
     return 0;
 }
-/*                                Fin du programme principal                          */
-/* ************************************************************************************/
 
-/* Implémentation de quelques fonctions utiles */
-/***********************************************/
+// ouverture en écriture du tube partagé avec le serveur et écriture de la requête
+int envoyerRequete(struct requete *req) {
+    int fdwrite;
+    if ((fdwrite = open(FIFO_NAME, O_WRONLY)) == -1) {
+        printf("\n\nImpossible d'ouvrir le tube en écriture: %s\n",
+               strerror(errno));
+        return EXIT_FAILURE;
+    }
+    if (write(fdwrite, req, sizeof(*req)) != sizeof(*req)) {
+        printf("\n\nImpossible d'écrire la requête dans le tube: %s\n", strerror(errno));
+        close(fdwrite);
+        return EXIT_FAILURE;
+    }
+    printf("\n==> La requête du client est écrite avec success dans le tube\n ");
+    close(fdwrite);
+    return EXIT_SUCCESS;
+}
+
+// dépôt du fichier de données sur le serveur comme jeu de données "nom":
+// mêmes étapes qu'une requête de calcul, sans résultat à récupérer
+int deposerDataset(char *nom, char *fichier) {
+    int *data = NULL;
+    int nbDataValues = 0;
+    if (strlen(nom) >= TAILLE_NOM_DATASET || strchr(nom, ' ') != NULL) {
+        printf("\nNom de jeu de données incorrect (au plus %d caractères, sans espace)\n",
+               TAILLE_NOM_DATASET - 1);
+        return EXIT_FAILURE;
+    }
+    if (lireData(&data, &nbDataValues, fichier) == EXIT_FAILURE) {
+        printf("Erreur dans le fichier de données");
+        return EXIT_FAILURE;
+    }
+    printf("\n==> %d valeurs lues à partir du fichier %s\n", nbDataValues, fichier);
+
+    int shmid;
+    struct shmseg *shmp = creerSegment(TAILLE_SEGMENT(nbDataValues), &shmid);
+    if (shmp == NULL) {
+        free(data);
+        return EXIT_FAILURE;
+    }
+
+    struct requete req;
+    memset(&req, 0, sizeof(req));
+    req.type     = REQUETE_DEPOT_DATASET;
+    req.pid      = getpid();
+    req.dataSize = nbDataValues;            // nombre d'entiers du jeu
+    strncpy(req.dataset, nom, TAILLE_NOM_DATASET - 1);
+
+    shmp->status = DEBUT_DEPOT_DATA;
+    if (envoyerRequete(&req) == EXIT_FAILURE) {
+        free(data);
+        detruireSegment(shmp, shmid);
+        return EXIT_FAILURE;
+    }
+    for (int premier=0; premier<nbDataValues; premier+=TAILLE_BLOC_PIPELINE) {
+        int nb = (nbDataValues - premier < TAILLE_BLOC_PIPELINE) ? nbDataValues - premier : TAILLE_BLOC_PIPELINE;
+        memcpy(&shmp->data[premier], &data[premier], (size_t)nb * sizeof(int));
+        __atomic_store_n(&shmp->nbDeposes, premier + nb, __ATOMIC_RELEASE);
+    }
+    free(data);
+
+    int status = attendreResultats(shmp, NULL, 1, nbDataValues);
+    if (status == ERREUR_REQUETE) {
+        printf("\n==> Dépôt du jeu de données \"%s\" refusé par le serveur\n", nom);
+    } else {
+        printf("\n==> Jeu de données \"%s\" déposé sur le serveur (%d valeurs)\n", nom, nbDataValues);
+    }
+    detruireSegment(shmp, shmid);
+    return (status == ERREUR_REQUETE) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+// calcul de l'opération sur le jeu de données "nom" déjà déposé: le segment
+// n'est qu'un segment de sortie, dimensionné d'après le catalogue des jeux
+int calculerDataset(char *nom, int operation, int plan, int nbThreads) {
+    int nbDataValues = lireTailleDataset(CATALOGUE_DATASETS, nom);
+    if (nbDataValues < 0) {
+        printf("\nLe jeu de données \"%s\" n'est pas disponible sur le serveur\n", nom);
+        return EXIT_FAILURE;
+    }
+    int taille = tailleElement(operation);
+    if (nbDataValues % taille != 0) {
+        printf("\nL'opération %s attend des éléments de %d valeurs: ", descripteurOperation(operation)->nom, taille);
+        printf("le jeu de données \"%s\" n'en compte pas un multiple\n", nom);
+        return EXIT_FAILURE;
+    }
+    int *resultats = malloc((size_t)nbDataValues * sizeof(int));
+    if (resultats == NULL) return EXIT_FAILURE;
+
+    int shmid;
+    struct shmseg *shmp = creerSegment(TAILLE_SEGMENT(nbDataValues), &shmid);
+    if (shmp == NULL) {
+        free(resultats);
+        return EXIT_FAILURE;
+    }
+
+    struct requete req;
+    memset(&req, 0, sizeof(req));
+    req.type      = REQUETE_CALCUL_DATASET;
+    req.pid       = getpid();
+    req.dataSize  = nbDataValues / taille;  // nombre d'éléments
+    req.operation = operation;
+    req.plan      = plan;
+    req.nbThreads = nbThreads;
+    strncpy(req.dataset, nom, TAILLE_NOM_DATASET - 1);
+
+    shmp->status = FIN_DEPOT_DATA;          // rien à déposer
+    if (envoyerRequete(&req) == EXIT_FAILURE) {
+        free(resultats);
+        detruireSegment(shmp, shmid);
+        return EXIT_FAILURE;
+    }
+
+    printf("\n==> Attente de la remise du résultat par les workers (serveur)...\n");
+    int retour = EXIT_SUCCESS;
+    if (attendreResultats(shmp, resultats, taille, 0) == ERREUR_REQUETE) {
+        printf("\n==> Requête sur le jeu de données \"%s\" refusée par le serveur\n", nom);
+        retour = EXIT_FAILURE;
+    } else {
+        printf("\n==> Traitelent du coté serveur terminé. Voici le résultat:\n\n    ");
+        afficherData(resultats, nbDataValues);
+        printf("\n==> Plan d'exécution retenu : %s, %d thread(s), calcul en %lld µs\n",
+               nomPlan(shmp->plan), shmp->nbThreads, shmp->dureeCalcul / 1000);
+    }
+    free(resultats);
+    detruireSegment(shmp, shmid);
+    return retour;
+}
 
 // lecture des données depuis un fichier et renvoi du nombre de ces
-// données et de leur valeurs dans un tableau d'entiers
-int lireData(int *data, int *nbValeurs, char *fichier) {
+// données et de leur valeurs dans un tableau d'entiers alloué au fur
+// et à mesure de la lecture (à libérer par l'appelant)
+int lireData(int **data, int *nbValeurs, char *fichier) {
     FILE *f;
     char chaine[100];
+    int capacite = NB_MAX_AFFICHAGE;
 
     f = fopen(fichier, "r");
     if (f == NULL) {
         printf("le fichier de données n'a pas pu être ouvert ...");
         return EXIT_FAILURE;
     }
+    *data = malloc(capacite * sizeof(int));
+    if (*data == NULL) {
+        fclose(f);
+        return EXIT_FAILURE;
+    }
     char *ptr;
     int i = 0;
     int j = 0;
     while (1) {
         for (int i=0; i<100; i++) chaine[i]='\0';
-        char c= '0';
+        int c= '0';
         i = 0;
-        while (c!=EOF && c!=' ') {
+        while (c!=EOF && c!=' ' && i<99) {
             c = fgetc(f);
             chaine[i] = c;
             i++;
         }
-        data[j] = strtol(chaine, &ptr, 10);
+        if (j == capacite) {
+            capacite *= 2;
+            int *plusGrand = realloc(*data, capacite * sizeof(int));
+            if (plusGrand == NULL) {
+                fclose(f);
+                return EXIT_FAILURE;
+            }
+            *data = plusGrand;
+        }
+        (*data)[j] = strtol(chaine, &ptr, 10);
         j++;
         if (c==EOF) break;
     }
@@ -249,11 +576,13 @@ int lireData(int *data, int *nbValeurs, char *fichier) {
 // *******************************
 
 void afficherData(int *T, int size) {
+    int nbAffiches = (size > NB_MAX_AFFICHAGE) ? NB_MAX_AFFICHAGE : size;
     printf("[");
-    for (int i=0; i<size; i++) {
+    for (int i=0; i<nbAffiches; i++) {
         printf("%d", T[i]);
         if (i!=size-1) printf(", ");
     }
+    if (nbAffiches < size) printf("... (%d valeurs)", size);
     printf("]\n");
 
 }
@@ -267,8 +596,26 @@ void afficherErreurUsage() {
     printf("   ---> ./client est le fichier exécutale \n");
     printf("   ---> data est le nom du fichier de données \n");
     printf("   ---> 1 est le numéro de l'opération à appliquer sur les données \n");
+    printf("        (le nom de l'opération convient aussi: ./client data addition)\n");
+    printf("Vous pouvez aussi imposer le plan d'exécution et le nombre de threads:\n");
+    printf("   ---> ./client data 1 [sequentiel|simd|blocs|distribue|hillis-steele [nbThreads]]\n");
     printf("Remarque: vous devez indiquer le chemin complet vers le fichier ");
     printf("Si ce dernier n'est pas dans le même dossier que le fichier exécutable './client'\n\n");
+    printf("Pour un fichier trop grand pour la mémoire, utilisez le mode flux, calculé\n");
+    printf("localement par le client sans le serveur (opérations associatives seulement):\n");
+    printf("   ---> ./client -f <fichierEntrée> <opération> <fichierSortie>\n\n");
+    printf("Pour déposer une fois un fichier sur le serveur puis calculer sur ce jeu:\n");
+    printf("   ---> ./client -d <nomJeu> <fichier>\n");
+    printf("   ---> ./client -n <nomJeu> <opération> [plan [nbThreads]]\n\n");
+}
+
+/* L'opération est donnée par son numéro ou par son nom ("affine", "ou"...).
+   Le nom est résolu avec le catalogue courant: il reste valable même si
+   les plugins du serveur changent.
+   ***************************************************************************/
+int operationDepuisArgument(const char *arg) {
+    int operation = chercherOperation(arg);
+    return (operation > 0) ? operation : atoi(arg);
 }
 
 void afficherOperationsPossibles() {
@@ -278,6 +625,11 @@ void afficherOperationsPossibles() {
     printf("   ---> 4 : MAXIMUM\n");
     printf("   ---> 5 : MINIMUM\n");
     printf("   ---> 6 : PGCD\n");
+    for (int op=NB_OPERATIONS+1; op<=numeroMaxOperation(); op++) {
+        if (!operationExiste(op)) continue;
+        const operation_t *desc = descripteurOperation(op);
+        printf("   ---> %d : %s (plugin, %d valeur(s) par élément)\n", op, desc->nom, desc->taille);
+    }
 }
 
 void afficherErreurOperation() {
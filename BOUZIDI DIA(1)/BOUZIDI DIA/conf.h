@@ -15,14 +15,26 @@
 #define BUFFER_LENGTH 30        // Longeur du buffer de lecture
 #define DATA_PATH "./data"		// nom du fichier de données par défaut
 #define BUF_SIZE 256            // taille maxi du buffer de données
-#define NB_MAX_VALEURS 256      // Nombre maximum de valeurs dans le tableau de données
+#define NB_MAX_AFFICHAGE 256    // Nombre maximum de valeurs affichées d'un tableau
 #define NB_MAXI_THREADS 256     // Nombre maximum de threadhs
 #define NB_MAX_WORKERS  200     // Nombre MAXIMUM
 
+// Paramètres du mode flux (fichiers plus grands que la mémoire)
+// *************************************************************
+// (TAILLE_BLOC_FLUX et TAILLE_TAMPON_FLUX sont réduits par "make verifier-flux"
+// pour que le petit fichier Data/flux traverse plusieurs blocs)
+#ifndef TAILLE_BLOC_FLUX
+#define TAILLE_BLOC_FLUX   65536    // nombre de valeurs par bloc lu/calculé/écrit
+#endif
+#define NB_BLOCS_FLUX      3        // blocs du tampon borné: lecture, calcul, écriture
+#ifndef TAILLE_TAMPON_FLUX
+#define TAILLE_TAMPON_FLUX (1<<20)  // taille des tampons de lecture/écriture (octets)
+#endif
+
 // Défintion des constantes permettant d'identifier les opérations de calcul
 // *************************************************************************
 
-#define NB_OPERATIONS     7
+#define NB_OPERATIONS     6
 
 #define ADDITION          1
 #define SOUSTRACTION      2
@@ -31,34 +43,134 @@
 #define MINIMUM           5
 #define PGCD              6
 
+// Opérations ajoutées par des plugins (voir plugins.c et plugins/plugin.h)
+// Chaque plugin choisit son numéro (plugin_code) entre NB_OPERATIONS+1 et
+// NB_MAX_OPERATIONS: il ne change pas quand on ajoute ou retire un autre
+// plugin. Le serveur publie la liste des opérations dans CATALOGUE_OPERATIONS,
+// où le client peut aussi chercher une opération par son nom.
+// ************************************************************************
+
+#define DOSSIER_PLUGINS      "./plugins"
+#define CATALOGUE_OPERATIONS "./operations.lst"
+#define NB_MAX_PLUGINS       32
+#define NB_MAX_OPERATIONS    (NB_OPERATIONS + NB_MAX_PLUGINS)
+#define TAILLE_MAX_ELEMENT   16     // nombre maximum d'entiers par élément
+#define TAILLE_NOM_OPERATION 32     // nom sans espace, '\0' compris
+
+// Défintion des stratégies d'exécution d'une requête (voir planificateur.c)
+// *************************************************************************
+
+#define NB_PLANS           6
+
+#define PLAN_AUTO          0    // choisie par le planificateur
+#define PLAN_SEQUENTIEL    1    // boucle séquentielle
+#define PLAN_SIMD          2    // boucle vectorisée sur un seul coeur
+#define PLAN_BLOCS         3    // un bloc par thread, puis report des retenues
+#define PLAN_DISTRIBUE     4    // un bloc par processus fils du worker
+#define PLAN_HILLIS_STEELE 5    // algorithme historique de Hills Steel Scan
+
+#define TAILLE_CALIBRAGE   65536 // nombre de valeurs des micro-benchmarks
+
+// Taille (en éléments) des blocs déposés par le client et calculés par le
+// worker au fur et à mesure, sans attendre la fin du dépôt
+#define TAILLE_BLOC_PIPELINE 65536
+// Pour les plans parallèles (blocs, distribue), les threads ou processus sont
+// relancés à chaque bloc: la requête est alors découpée en au plus
+// NB_BLOCS_PIPELINE_PARALLELE blocs (d'au moins TAILLE_BLOC_PIPELINE éléments)
+#define NB_BLOCS_PIPELINE_PARALLELE 4
+
+// Jeux de données nommés, gardés en mémoire par le serveur (voir datasets.c)
+// *************************************************************************
+#define CATALOGUE_DATASETS  "./datasets.lst"
+#define NB_MAX_DATASETS     32
+#define TAILLE_NOM_DATASET  32
+#define CAPACITE_DATASETS   (256L << 20)   // octets gardés au plus, au-delà on évince
+#define TAILLE_HUGE_PAGE    (2L << 20)     // jeux de cette taille et plus: huge pages
+
+// Types de requêtes
+// *****************
+#define REQUETE_CALCUL          0   // calcul sur les données du segment du client
+#define REQUETE_DEPOT_DATASET   1   // dépôt d'un jeu de données nommé
+#define REQUETE_CALCUL_DATASET  2   // calcul sur un jeu de données déjà déposé
+
+// Canal de contrôle du serveur, utilisé par le programme ctrl (voir controle.c)
+// ****************************************************************************
+#define SOCKET_CONTROLE        "./serveur.sock"
+#define TAILLE_COMMANDE        256
+#define NB_CONNEXIONS_CONTROLE 8    // connexions de contrôle dont la commande est en cours de lecture
+#define DELAI_COMMANDE         2    // secondes laissées au ctrl pour écrire sa commande
+#define DELAI_PASSATION        60   // secondes laissées au nouveau serveur pour démarrer
 
 
 // Défintion des constantes permettant d'identifier qui
 // occupe le segment de mémoire partagé à un moment donnée
+// Le dépôt et le calcul se recouvrent: pendant DEBUT_DEPOT_DATA, le worker
+// calcule déjà les blocs comptés dans nbDeposes. Le client n'écrit le statut
+// qu'avant l'envoi de la requête; ensuite seul le worker l'écrit
 // *******************************************************
 #define DEBUT_DEPOT_DATA     0
 #define FIN_DEPOT_DATA       1
 #define FIN_REMISE_RESULTATS 2
+#define ERREUR_REQUETE       3      // requête refusée (jeu de données inconnu, ...)
 
 
-    // création d'une variable "shmseg" est une struture composée de 2 champs
-    // -> data : un tableau de données
+    // création d'une variable "shmseg" est une struture composée des champs
     // -> status : pour synchroniser le client et le serveur
     //    status = DATA_FOURNIES (1) indique que les données sont déposé en mémoire
     //             partagée par le client
     //    status = CALCUL_TERMINE (2) indique que le worker a rendu le résultats
     //             dans la mémoire  partagé
+    // -> nbDeposes : nombre d'éléments déjà déposés par le client
+    // -> nbCalcules : nombre d'éléments dont le résultat est déjà disponible,
+    //    le client peut les récupérer avant la fin du calcul
+    //    Ces deux compteurs sont lus et écrits avec __atomic_load_n/__atomic_store_n
+    //    pour que les données du bloc soient visibles avant le compteur
+    // -> pidWorker : PID du worker qui a pris la requête en charge (0 avant),
+    //    le client s'en sert pour ne pas attendre un worker disparu
+    // -> plan, nbThreads, dureeCalcul : métriques de la requête rendues par le
+    //    worker (stratégie retenue, nombre de threads et durée du calcul en ns)
+    // -> data : un tableau de données dont la taille est fixée par le client
+    //    à la création du segment (voir TAILLE_SEGMENT)
 
 
 struct shmseg {
-    int data[NB_MAX_VALEURS];
     int status;
+    int nbDeposes;
+    int nbCalcules;
+    int pidWorker;
+    int plan;
+    int nbThreads;
+    long long dureeCalcul;
+    int data[];
 };
 
+#define TAILLE_SEGMENT(nbValeurs) (sizeof(struct shmseg) + (size_t)(nbValeurs) * sizeof(int))
+
+
+    // Segment d'un jeu de données nommé, créé et gardé par le serveur
+    // -> etat : DATASET_EN_DEPOT pendant la copie depuis le client qui l'a
+    //    déposé, puis DATASET_PRET, ou DATASET_ERREUR si le dépôt a échoué
+    // -> pidDepot : PID du worker qui copie le jeu (0 avant son lancement)
+    // -> data : aligné sur une ligne de cache
+
+#define DATASET_EN_DEPOT 0
+#define DATASET_PRET     1
+#define DATASET_ERREUR   2
+
+struct datasetseg {
+    int etat;
+    int nbValeurs;
+    int pidDepot;
+    int data[] __attribute__ ((aligned (64)));
+};
+
+#define TAILLE_DATASET(nbValeurs) (sizeof(struct datasetseg) + (size_t)(nbValeurs) * sizeof(int))
+
 
 /*****************************************************************/
 /* Structure "requete" permettant de définir le type des données */
-/* Elle est composée de 3 champs:                                */
+/* Elle est composée de 7 champs:                                */
+/*   ---> Le type de requête (REQUETE_CALCUL, ...)               */
 /*   ---> Le PID du client                                       */
 /*   ---> La taille du tableau de données                        */
 /*   ---> Le numéro de l'opération à effectuer par les workres   */
@@ -68,18 +180,30 @@ struct shmseg {
 /*          4 : maximum                                          */
 /*          5 : minimum                                          */
 /*          6 : PGCD                                             */
+/*        7 et plus : opérations des plugins. Leurs éléments     */
+/*        peuvent être composés de plusieurs entiers, dataSize   */
+/*        est alors un nombre d'éléments                         */
+/*   ---> Le plan d'exécution imposé par le client (PLAN_AUTO    */
+/*        pour laisser le planificateur choisir)                 */
+/*   ---> Le nombre de threads imposé (0 pour le choix auto)     */
+/*   ---> Le nom du jeu de données pour REQUETE_DEPOT_DATASET    */
+/*        et REQUETE_CALCUL_DATASET                              */
 /*****************************************************************/
 
 struct requete {
+    int type;
     int pid;
     int dataSize;
     int operation;
+    int plan;
+    int nbThreads;
+    char dataset[TAILLE_NOM_DATASET];
 };
 
 
 
-int listWorkers [NB_MAX_WORKERS];
-int nbWorkers;
+extern int listWorkers [NB_MAX_WORKERS];
+extern int nbWorkers;
 
 
 #endif /* CONF_H_ */
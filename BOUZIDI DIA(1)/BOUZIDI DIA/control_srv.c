@@ -43,7 +43,13 @@
  ---> Paramétrer l'application (création du fichier de configuration et
  	  fixation des paramètres (data sorce, taille du tubes, etc...)
  ---> Lancement du serveur (démon)
- ---> Arrêt du serveur (démon)
+ ---> Arrêt du serveur (démon): drain par le canal de contrôle (le serveur
+ 	  termine ses requêtes en cours), ou SIGKILL s'il ne répond pas
+ ---> Statistiques du serveur (file d'attente, latence, réglages)
+ ---> Réglage du serveur pendant son exécution (workers, threads, cache)
+ ---> Redémarrage du serveur sans interruption du service
+ ---> Affichage des opérations disponibles (opérations de base et plugins
+ 	  chargés par le serveur, lues dans le catalogue qu'il publie)
  ---> Création d'une requêtte et lancement d'un client
  */
 
@@ -56,10 +62,22 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <signal.h>
+#include <sys/wait.h>
 
 #include "conf.h"
+#include "operations.h"
+#include "controle.h"
+
+#define TAILLE_REPONSE 4096
 
 int menu(void);
+void afficherOperations(void);
+int  commanderServeur(const char *commande);
+int  serveurActif(void);
+void arreterServeur(pid_t *p_serveur, int attendre);
+void attendreFin(pid_t pid);
+void redemarrerServeur(pid_t *p_serveur);
+void reglerServeur(void);
 
 int main(void) {
     pid_t p_serveur = -10;
@@ -67,10 +85,17 @@ int main(void) {
         int choix = menu();
         system("clear");
 
+        // serveurs lancés par ctrl et arrêtés depuis (drain, redémarrage).
+        // Après un redémarrage, le serveur suivi n'est plus un fils de ctrl
+        while (waitpid(-1, NULL, WNOHANG) > 0);
+        if (p_serveur != -10 && kill(p_serveur, 0) == -1) {
+            p_serveur = -10;
+        }
+
         switch (choix) {
         case 1 :
             system("clear");
-            if (p_serveur == -10) {
+            if (p_serveur == -10 && !serveurActif()) {
                 p_serveur = fork();
                 if (p_serveur==0) {
                     execl ("./serveur", "", NULL);
@@ -82,27 +107,29 @@ int main(void) {
             break;
         case 2 :
             system("clear");
-            if (p_serveur!=-10) {
-                kill(p_serveur, SIGKILL);
-                printf("Serveur correctement stoppé !");
-                p_serveur = -10;
-            } else {
-                printf("Serveur déjà stoppé, donc rien à faire !");
+            arreterServeur(&p_serveur, FALSE);
+            break;
+        case 3 :
+            afficherOperations();
+            break;
+        case 4 :
+            if (commanderServeur("statistiques") == EXIT_FAILURE) {
+                printf("Le serveur ne répond pas: est-il lancé ?");
             }
             break;
+        case 5 :
+            reglerServeur();
+            break;
+        case 6 :
+            redemarrerServeur(&p_serveur);
+            break;
         default: break;
         }
 
-        if (choix==3)
+        if (choix==7)
         {
             system("clear");
-            if (p_serveur!=-10) {
-                kill(p_serveur, SIGKILL);
-                printf("Serveur correctement stoppé !");
-                p_serveur = -10;
-            } else {
-                printf("Serveur déjà stoppé, donc rien à faire !");
-            }
+            arreterServeur(&p_serveur, TRUE);
             printf("\nApplication terminée correctement \n");
             break;
 
@@ -115,6 +142,99 @@ int main(void) {
     return EXIT_SUCCESS;
 }
 
+/*****************************************************************/
+/* Envoi d'une commande au serveur par le canal de contrôle et   */
+/* affichage de sa réponse                                       */
+/*****************************************************************/
+int commanderServeur(const char *commande) {
+    char reponse[TAILLE_REPONSE];
+    if (envoyerCommande(SOCKET_CONTROLE, commande, reponse, sizeof(reponse)) == EXIT_FAILURE) {
+        return EXIT_FAILURE;
+    }
+    printf("%s", reponse);
+    return EXIT_SUCCESS;
+}
+
+/* Un serveur (lancé ou non par ce ctrl) répond-il sur le canal de contrôle ? */
+int serveurActif(void) {
+    char reponse[TAILLE_REPONSE];
+    return envoyerCommande(SOCKET_CONTROLE, "statistiques", reponse, sizeof(reponse)) == EXIT_SUCCESS;
+}
+
+/*****************************************************************/
+/* Arrêt du serveur: drain par le canal de contrôle, et attente  */
+/* de sa fin si "attendre". Sans réponse du serveur lancé par    */
+/* ctrl, il est tué.                                             */
+/*****************************************************************/
+void arreterServeur(pid_t *p_serveur, int attendre) {
+    if (commanderServeur("drainer") == EXIT_SUCCESS) {
+        if (attendre && *p_serveur != -10) {
+            printf("Attente de la fin des requêtes en cours...\n");
+            attendreFin(*p_serveur);
+            *p_serveur = -10;
+        }
+        printf("Serveur correctement stoppé !");
+    } else if (*p_serveur != -10) {
+        kill(*p_serveur, SIGKILL);
+        attendreFin(*p_serveur);
+        printf("Serveur sans canal de contrôle, tué !");
+        *p_serveur = -10;
+    } else {
+        printf("Serveur déjà stoppé, donc rien à faire !");
+    }
+}
+
+/* Attente de la fin du serveur "pid": par waitpid s'il a été lancé par
+   ctrl, sinon (serveur issu d'un redémarrage) en testant sa présence
+   *****************************************************************/
+void attendreFin(pid_t pid) {
+    if (waitpid(pid, NULL, 0) == -1 && errno == ECHILD) {
+        while (kill(pid, 0) == 0) usleep(100000);
+    }
+}
+
+/*****************************************************************/
+/* Redémarrage du serveur. Le nouveau serveur est lancé par      */
+/* l'ancien: ctrl suit désormais le PID annoncé dans la réponse  */
+/* (voir terminerRedemarrage dans serveur.c)                     */
+/*****************************************************************/
+void redemarrerServeur(pid_t *p_serveur) {
+    char reponse[TAILLE_REPONSE];
+    int nouveau;
+    printf("Redémarrage du serveur (calibrage du nouveau serveur)...\n\n");
+    if (envoyerCommande(SOCKET_CONTROLE, "redemarrer", reponse, sizeof(reponse)) == EXIT_FAILURE) {
+        printf("Le serveur ne répond pas: est-il lancé ?");
+        return;
+    }
+    printf("%s", reponse);
+    const char *annonce = strstr(reponse, "sous le PID ");
+    if (annonce != NULL && sscanf(annonce, "sous le PID %d", &nouveau) == 1) {
+        *p_serveur = nouveau;
+    }
+}
+
+/*****************************************************************/
+/* Saisie et envoi d'un réglage du serveur                       */
+/*****************************************************************/
+void reglerServeur(void) {
+    char parametre[32];
+    long valeur;
+    printf("Réglages possibles :\n");
+    printf("   ---> workers <n> : nombre maximal de workers simultanés (1 à %d)\n", NB_MAX_WORKERS);
+    printf("   ---> threads <n> : threads au plus par requête (0 : choix du planificateur)\n");
+    printf("   ---> cache <n>   : capacité des jeux de données en Mio\n\n");
+    printf("Réglage : ");
+    if (scanf("%31s %ld", parametre, &valeur) != 2) {
+        printf("Réglage incorrect");
+        return;
+    }
+    char commande[TAILLE_COMMANDE];
+    snprintf(commande, sizeof(commande), "regler %s %ld", parametre, valeur);
+    if (commanderServeur(commande) == EXIT_FAILURE) {
+        printf("Le serveur ne répond pas: est-il lancé ?");
+    }
+}
+
 /*****************************************************************/
 /* Fonction affichant le menu principal du programme de contrôle */
 /* des serveurs et des clients                                   */
@@ -128,12 +248,16 @@ int menu(void) {
         printf(" │***************************************│\n");
         printf(" │ --> 1 - Lancer le serveur de calculs  │\n");
         printf(" │ --> 2 - Arrêter le serveur de calculs │\n");
-        printf(" │ --> 3 - Quitter                       │\n");
+        printf(" │ --> 3 - Opérations disponibles        │\n");
+        printf(" │ --> 4 - Statistiques du serveur       │\n");
+        printf(" │ --> 5 - Régler le serveur             │\n");
+        printf(" │ --> 6 - Redémarrer le serveur         │\n");
+        printf(" │ --> 7 - Quitter                       │\n");
         printf(" │***************************************│\n");
         printf("\n");
 
         choix = getchar();
-        if ((choix >'0') & (choix <'4')) {
+        if ((choix >'0') & (choix <'8')) {
             break;
         }
     }
@@ -141,3 +265,22 @@ int menu(void) {
     return (int)choix-48;
 }
 
+
+
+/*****************************************************************/
+/* Affichage des opérations publiées par le serveur, y compris   */
+/* celles de ses plugins                                         */
+/*****************************************************************/
+void afficherOperations(void) {
+    if (lireCatalogue(CATALOGUE_OPERATIONS) == EXIT_FAILURE) {
+        printf("Catalogue %s introuvable: lancez d'abord le serveur", CATALOGUE_OPERATIONS);
+        return;
+    }
+    printf("Opérations disponibles :\n\n");
+    for (int op=1; op<=numeroMaxOperation(); op++) {
+        if (!operationExiste(op)) continue;
+        const operation_t *desc = descripteurOperation(op);
+        printf("   ---> %2d : %-16s %d valeur(s) par élément%s\n", op, desc->nom, desc->taille,
+               (op > NB_OPERATIONS) ? " (plugin)" : "");
+    }
+}
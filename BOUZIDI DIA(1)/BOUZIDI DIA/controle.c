@@ -0,0 +1,238 @@
+/**
+ * \file controle.c
+ * \brief Canal de contrôle du serveur par une socket Unix.
+ * \author Louisa BOUZIDI et Modou Ndiar DIA
+ * \version 0.1
+ * \date 28 decembre 2022
+ *
+ * Le programme de contrôle se connecte à la socket SOCKET_CONTROLE, écrit
+ * une commande terminée par un retour à la ligne puis lit la réponse du
+ * serveur jusqu'à la fermeture de la connexion. Les commandes sont
+ * interprétées par le serveur (voir traiterCommande dans serveur.c):
+ *   ---> statistiques
+ *   ---> regler <workers|threads|cache> <valeur>
+ *   ---> drainer
+ *   ---> redemarrer
+ * Le serveur n'a qu'un thread: la socket d'écoute et les connexions sont
+ * non bloquantes et surveillées avec le tube dans sa boucle poll(). Une
+ * commande vide ferme la connexion sans réponse (test de présence).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "conf.h"
+#include "controle.h"
+
+/* Connexions acceptées dont la commande n'est pas encore complète
+   ************************************************************************/
+typedef struct connexion_t connexion_t;
+
+struct connexion_t {
+    int    fd;
+    int    lg;                          // octets de la commande déjà lus
+    time_t debut;                       // heure de la connexion
+    char   commande[TAILLE_COMMANDE];
+};
+
+static connexion_t connexions[NB_CONNEXIONS_CONTROLE];
+static int nbConnexions = 0;
+
+static time_t maintenant(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec;
+} //----------------------------------------------------------------------
+
+static int adresseControle(struct sockaddr_un *adresse, const char *chemin) {
+    memset(adresse, 0, sizeof(*adresse));
+    adresse->sun_family = AF_UNIX;
+    if (strlen(chemin) >= sizeof(adresse->sun_path)) return FALSE;
+    strcpy(adresse->sun_path, chemin);
+    return TRUE;
+} //----------------------------------------------------------------------
+
+/**********************************************************************/
+/* Création de la socket d'écoute du canal de contrôle, renvoie son   */
+/* descripteur ou -1                                                  */
+/**********************************************************************/
+int ouvrirControle(const char *chemin) {
+    struct sockaddr_un adresse;
+    if (!adresseControle(&adresse, chemin)) return -1;
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd == -1) {
+        perror("Socket de contrôle");
+        return -1;
+    }
+    unlink(chemin);     // socket laissée par un serveur précédent
+    if (bind(fd, (struct sockaddr *)&adresse, sizeof(adresse)) == -1 || listen(fd, 8) == -1) {
+        fprintf(stderr, "Canal de contrôle %s indisponible: %s\n", chemin, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    fcntl(fd, F_SETFL, O_NONBLOCK);     // accept() ne doit jamais bloquer le serveur
+    return fd;
+} //----------------------------------------------------------------------
+
+static void retirerConnexion(int i) {
+    nbConnexions--;
+    connexions[i] = connexions[nbConnexions];
+} //----------------------------------------------------------------------
+
+/**********************************************************************/
+/* Descripteurs à surveiller pour le canal de contrôle: la socket     */
+/* d'écoute (sauf si la table des connexions est pleine) puis les     */
+/* connexions en cours de lecture. Celles ouvertes depuis plus de     */
+/* DELAI_COMMANDE secondes sont abandonnées. Renvoie le nombre        */
+/* d'entrées de "attente" remplies (au plus 1+NB_CONNEXIONS_CONTROLE) */
+/**********************************************************************/
+int attenteControle(int fdControle, struct pollfd *attente) {
+    time_t t = maintenant();
+    int i = 0;
+    while (i < nbConnexions) {
+        if (t - connexions[i].debut > DELAI_COMMANDE) {
+            close(connexions[i].fd);
+            retirerConnexion(i);
+        } else {
+            i++;
+        }
+    }
+    attente[0].fd     = (nbConnexions < NB_CONNEXIONS_CONTROLE) ? fdControle : -1;
+    attente[0].events = POLLIN;
+    for (i=0; i<nbConnexions; i++) {
+        attente[1+i].fd     = connexions[i].fd;
+        attente[1+i].events = POLLIN;
+    }
+    return 1 + nbConnexions;
+} //----------------------------------------------------------------------
+
+/* Lecture, sans bloquer, de ce qui est arrivé sur la connexion "i".
+   Renvoie TRUE si sa commande est complète (retour à la ligne, fin de
+   la connexion ou tampon plein). Une connexion fermée sans commande, ou
+   en erreur, est fermée et retirée de la table.
+   ************************************************************************/
+static int lireConnexion(int i) {
+    connexion_t *c = &connexions[i];
+    ssize_t n = read(c->fd, &c->commande[c->lg], TAILLE_COMMANDE - 1 - c->lg);
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) return FALSE;
+    if (n < 0) c->lg = 0;               // connexion en erreur: abandonnée
+    if (n > 0) {
+        char *fin = memchr(&c->commande[c->lg], '\n', n);
+        c->lg = (fin != NULL) ? (int)(fin - c->commande) : c->lg + (int)n;
+        c->commande[c->lg] = '\0';
+        if (fin == NULL && c->lg < TAILLE_COMMANDE - 1) return FALSE;
+    }
+    if (c->lg == 0) {
+        close(c->fd);
+        retirerConnexion(i);
+        return FALSE;
+    }
+    return TRUE;
+} //----------------------------------------------------------------------
+
+/**********************************************************************/
+/* Après poll() sur les entrées remplies par attenteControle:         */
+/* acceptation des nouvelles connexions et lecture des commandes      */
+/* arrivées. Renvoie le descripteur d'une connexion dont la commande  */
+/* est complète (copiée dans "commande"), sur lequel le serveur écrit */
+/* sa réponse avant de le fermer, ou -1 s'il n'y en a plus. A appeler */
+/* jusqu'à -1.                                                        */
+/**********************************************************************/
+int lireCommande(struct pollfd *attente, int nbAttente, char *commande, int taille) {
+    for (int k=1; k<nbAttente; k++) {
+        if (attente[k].revents == 0) continue;
+        attente[k].revents = 0;
+        for (int i=0; i<nbConnexions; i++) {
+            if (connexions[i].fd != attente[k].fd) continue;
+            if (!lireConnexion(i)) break;
+            int fd = connexions[i].fd;
+            snprintf(commande, taille, "%s", connexions[i].commande);
+            retirerConnexion(i);
+            return fd;
+        }
+    }
+
+    while ((attente[0].revents & POLLIN) && nbConnexions < NB_CONNEXIONS_CONTROLE) {
+        int fd = accept(attente[0].fd, NULL, NULL);
+        if (fd == -1) break;
+        fcntl(fd, F_SETFL, O_NONBLOCK);
+        fcntl(fd, F_SETFD, FD_CLOEXEC);     // pas transmise à un nouveau serveur
+        int i = nbConnexions++;
+        connexions[i].fd    = fd;
+        connexions[i].lg    = 0;
+        connexions[i].debut = maintenant();
+        if (lireConnexion(i)) {
+            snprintf(commande, taille, "%s", connexions[i].commande);
+            retirerConnexion(i);
+            return fd;
+        }
+    }
+    attente[0].revents = 0;
+    return -1;
+} //----------------------------------------------------------------------
+
+/* Dans un worker: fermeture des connexions héritées du serveur, pour que
+   le ctrl reçoive la fin de la réponse dès que le serveur a fermé la sienne
+   ************************************************************************/
+void fermerConnexions(void) {
+    for (int i=0; i<nbConnexions; i++) close(connexions[i].fd);
+    nbConnexions = 0;
+} //----------------------------------------------------------------------
+
+/**********************************************************************/
+/* Côté ctrl: envoi de "commande" au serveur et lecture de sa réponse */
+/* Renvoie EXIT_FAILURE si le serveur ne répond pas.                  */
+/**********************************************************************/
+int envoyerCommande(const char *chemin, const char *commande, char *reponse, int taille) {
+    struct sockaddr_un adresse;
+    if (!adresseControle(&adresse, chemin)) return EXIT_FAILURE;
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd == -1) return EXIT_FAILURE;
+    if (connect(fd, (struct sockaddr *)&adresse, sizeof(adresse)) == -1) {
+        close(fd);
+        return EXIT_FAILURE;
+    }
+    if (write(fd, commande, strlen(commande)) == -1 || write(fd, "\n", 1) == -1) {
+        close(fd);
+        return EXIT_FAILURE;
+    }
+
+    int lg = 0;
+    ssize_t n;
+    while (lg < taille - 1 && (n = read(fd, &reponse[lg], taille - 1 - lg)) > 0) {
+        lg += n;
+    }
+    reponse[lg] = '\0';
+    close(fd);
+    return EXIT_SUCCESS;
+}
+
+/**********************************************************************/
+/* Test de présence du serveur: connexion au canal de contrôle et     */
+/* envoi d'une commande vide, fermée par le serveur sans réponse.     */
+/* Renvoie FALSE si personne n'écoute sur la socket.                  */
+/**********************************************************************/
+int serveurJoignable(const char *chemin) {
+    struct sockaddr_un adresse;
+    if (!adresseControle(&adresse, chemin)) return FALSE;
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd == -1) return TRUE;      // rien ne permet de conclure à l'arrêt du serveur
+    // connexion non bloquante: si la file d'attente de la socket est pleine,
+    // le serveur est là mais occupé (EAGAIN)
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+    int joignable = connect(fd, (struct sockaddr *)&adresse, sizeof(adresse)) == 0
+                    || errno == EAGAIN || errno == EINPROGRESS;
+    if (joignable) write(fd, "\n", 1);
+    close(fd);
+    return joignable;
+}
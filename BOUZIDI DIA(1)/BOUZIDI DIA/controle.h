@@ -0,0 +1,26 @@
+/**
+ * controle.h
+ *
+ *  Created on: 23 déc. 2022
+ *      Author: Bouzidi Louisa et Dia Modou Ndiar
+ *
+ *  Canal de contrôle (socket Unix SOCKET_CONTROLE) entre le programme ctrl
+ *  et le serveur: une commande texte par connexion, suivie de la réponse.
+ */
+
+#ifndef CONTROLE_H_
+#define CONTROLE_H_
+
+#include <poll.h>
+
+// Côté serveur
+int  ouvrirControle(const char *chemin);
+int  attenteControle(int fdControle, struct pollfd *attente);
+int  lireCommande(struct pollfd *attente, int nbAttente, char *commande, int taille);
+void fermerConnexions(void);
+
+// Côté programme de contrôle et client
+int  envoyerCommande(const char *chemin, const char *commande, char *reponse, int taille);
+int  serveurJoignable(const char *chemin);
+
+#endif /* CONTROLE_H_ */
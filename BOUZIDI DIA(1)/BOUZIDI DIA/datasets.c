@@ -0,0 +1,333 @@
+/**
+ * \file datasets.c
+ * \brief Jeux de données nommés, gardés en mémoire partagée par le serveur.
+ * \author Louisa BOUZIDI et Modou Ndiar DIA
+ * \version 0.1
+ * \date 28 decembre 2022
+ *
+ * Un client dépose une fois un jeu de données sous un nom; les requêtes
+ * suivantes le désignent par ce nom et ne transfèrent plus que les
+ * résultats. Le registre est tenu par le serveur (le père):
+ *   ---> chaque jeu est un segment privé attaché par le serveur puis marqué
+ *        pour destruction (IPC_RMID): les workers, créés par fork, héritent
+ *        de l'attachement et le segment disparaît avec le dernier processus
+ *        qui l'utilise, même si le serveur est tué
+ *   ---> les jeux d'au moins TAILLE_HUGE_PAGE octets sont demandés en huge
+ *        pages (SHM_HUGETLB), avec repli sur des pages normales
+ *   ---> un compteur de références protège les jeux utilisés par un worker;
+ *        au-delà de CAPACITE_DATASETS octets ou de NB_MAX_DATASETS jeux, le
+ *        jeu non référencé le moins récemment utilisé est évincé; cette
+ *        capacité est réglable pendant l'exécution (fixerCapaciteDatasets)
+ *   ---> lors d'un redémarrage, les jeux prêts sont passés au nouveau
+ *        serveur par leur identifiant, qu'il rattache avant que l'ancien
+ *        serveur ne se termine (Linux permet d'attacher un segment marqué
+ *        pour destruction tant qu'il est encore attaché)
+ * La liste des jeux disponibles est publiée dans CATALOGUE_DATASETS.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include "conf.h"
+#include "datasets.h"
+
+typedef struct dataset_t dataset_t;
+
+struct dataset_t {
+    int                utilise;
+    char               nom[TAILLE_NOM_DATASET];
+    int                shmid;
+    struct datasetseg *seg;
+    size_t             octets;          // taille réellement allouée
+    int                refs;            // workers en cours sur ce jeu
+    long long          dernierAcces;    // pour l'éviction LRU
+};
+
+static dataset_t registre[NB_MAX_DATASETS];
+static size_t    octetsUtilises = 0;
+static size_t    capacite = CAPACITE_DATASETS;
+static long long horloge = 0;
+
+/* Nom utilisable dans le catalogue: non vide, sans espace
+   ************************************************************************/
+static int nomValide(const char *nom) {
+    size_t lg = strnlen(nom, TAILLE_NOM_DATASET);
+    if (lg == 0 || lg == TAILLE_NOM_DATASET) return FALSE;
+    for (size_t i=0; i<lg; i++) {
+        if (nom[i] <= ' ') return FALSE;
+    }
+    return TRUE;
+} //----------------------------------------------------------------------
+
+static void supprimerDataset(int i) {
+    shmdt(registre[i].seg);
+    octetsUtilises -= registre[i].octets;
+    registre[i].utilise = FALSE;
+} //----------------------------------------------------------------------
+
+/* Eviction du jeu non référencé le moins récemment utilisé.
+   Renvoie FALSE si tous les jeux sont utilisés par un worker.
+   ************************************************************************/
+static int evincerDataset(void) {
+    int victime = -1;
+    for (int i=0; i<NB_MAX_DATASETS; i++) {
+        if (registre[i].utilise && registre[i].refs == 0
+            && (victime < 0 || registre[i].dernierAcces < registre[victime].dernierAcces)) {
+            victime = i;
+        }
+    }
+    if (victime < 0) return FALSE;
+    printf("Jeu de données \"%s\" évincé (%zu octets)\n", registre[victime].nom, registre[victime].octets);
+    supprimerDataset(victime);
+    return TRUE;
+} //----------------------------------------------------------------------
+
+/* Création du segment, en huge pages si le jeu est assez grand
+   ************************************************************************/
+static struct datasetseg *allouerSegment(size_t *octets, int *id) {
+    int shmid = -1;
+#ifdef SHM_HUGETLB
+    if (*octets >= TAILLE_HUGE_PAGE) {
+        size_t arrondi = (*octets + TAILLE_HUGE_PAGE - 1) / TAILLE_HUGE_PAGE * TAILLE_HUGE_PAGE;
+        shmid = shmget(IPC_PRIVATE, arrondi, IPC_CREAT | SHM_HUGETLB | 0600);
+        if (shmid != -1) *octets = arrondi;
+    }
+#endif
+    if (shmid == -1) {
+        shmid = shmget(IPC_PRIVATE, *octets, IPC_CREAT | 0600);
+        if (shmid == -1) {
+            perror("Segment du jeu de données");
+            return NULL;
+        }
+    }
+
+    struct datasetseg *seg = shmat(shmid, NULL, 0);
+    shmctl(shmid, IPC_RMID, NULL);   // détruit au dernier détachement
+    if (seg == (void *) -1) {
+        perror("Attachement du jeu de données");
+        return NULL;
+    }
+    *id = shmid;
+    return seg;
+} //----------------------------------------------------------------------
+
+/**********************************************************************/
+/* Création du jeu "nom" de "nbValeurs" entiers, dans l'état          */
+/* DATASET_EN_DEPOT. Un jeu du même nom est remplacé s'il n'est pas   */
+/* utilisé. Renvoie l'indice du jeu ou -1.                            */
+/**********************************************************************/
+int creerDataset(const char *nom, int nbValeurs) {
+    if (!nomValide(nom) || nbValeurs <= 0) {
+        fprintf(stderr, "Jeu de données refusé: nom ou taille incorrect\n");
+        return -1;
+    }
+    size_t octets = TAILLE_DATASET(nbValeurs);
+    if (octets > capacite) {
+        fprintf(stderr, "Jeu de données \"%s\" refusé: %zu octets pour une capacité de %zu\n",
+                nom, octets, capacite);
+        return -1;
+    }
+
+    int existant = trouverDataset(nom);
+    if (existant >= 0) {
+        if (registre[existant].refs > 0) {
+            fprintf(stderr, "Jeu de données \"%s\" en cours d'utilisation, dépôt refusé\n", nom);
+            return -1;
+        }
+        supprimerDataset(existant);
+    }
+
+    int libre = -1;
+    while (TRUE) {
+        for (libre=0; libre<NB_MAX_DATASETS && registre[libre].utilise; libre++);
+        if (libre < NB_MAX_DATASETS && octetsUtilises + octets <= capacite) break;
+        if (!evincerDataset()) {
+            fprintf(stderr, "Jeu de données \"%s\" refusé: capacité atteinte\n", nom);
+            return -1;
+        }
+    }
+
+    int shmid;
+    struct datasetseg *seg = allouerSegment(&octets, &shmid);
+    if (seg == NULL) return -1;
+    seg->etat      = DATASET_EN_DEPOT;
+    seg->nbValeurs = nbValeurs;
+    seg->pidDepot  = 0;
+
+    dataset_t *d = &registre[libre];
+    memset(d, 0, sizeof(*d));
+    d->utilise      = TRUE;
+    strncpy(d->nom, nom, TAILLE_NOM_DATASET - 1);
+    d->shmid        = shmid;
+    d->seg          = seg;
+    d->octets       = octets;
+    d->dernierAcces = ++horloge;
+    octetsUtilises += octets;
+    return libre;
+} //----------------------------------------------------------------------
+
+/**********************************************************************/
+/* Recherche d'un jeu par son nom, renvoie son indice ou -1           */
+/**********************************************************************/
+int trouverDataset(const char *nom) {
+    for (int i=0; i<NB_MAX_DATASETS; i++) {
+        if (registre[i].utilise && strncmp(registre[i].nom, nom, TAILLE_NOM_DATASET) == 0) {
+            registre[i].dernierAcces = ++horloge;
+            return i;
+        }
+    }
+    return -1;
+} //----------------------------------------------------------------------
+
+void prendreDataset(int i) {
+    registre[i].refs++;
+} //----------------------------------------------------------------------
+
+/* Fin d'un worker: un jeu dont le dépôt a échoué est supprimé dès qu'il
+   n'est plus utilisé
+   ************************************************************************/
+void relacherDataset(int i) {
+    if (--registre[i].refs == 0
+        && __atomic_load_n(&registre[i].seg->etat, __ATOMIC_ACQUIRE) == DATASET_ERREUR) {
+        supprimerDataset(i);
+    }
+} //----------------------------------------------------------------------
+
+struct datasetseg *segmentDataset(int i) {
+    return registre[i].seg;
+} //----------------------------------------------------------------------
+
+size_t octetsDataset(int i) {
+    return registre[i].octets;
+} //----------------------------------------------------------------------
+
+/**********************************************************************/
+/* Réglage de la capacité (en octets): les jeux non référencés sont   */
+/* évincés jusqu'à repasser sous la nouvelle capacité.                */
+/**********************************************************************/
+void fixerCapaciteDatasets(size_t octets) {
+    capacite = octets;
+    while (octetsUtilises > capacite && evincerDataset());
+} //----------------------------------------------------------------------
+
+void etatDatasets(int *nbJeux, size_t *octets, size_t *capaciteMax) {
+    *nbJeux = 0;
+    for (int i=0; i<NB_MAX_DATASETS; i++) {
+        if (registre[i].utilise) (*nbJeux)++;
+    }
+    *octets      = octetsUtilises;
+    *capaciteMax = capacite;
+} //----------------------------------------------------------------------
+
+/* Description d'un jeu passé au nouveau serveur lors d'un redémarrage
+   ************************************************************************/
+typedef struct {
+    char   nom[TAILLE_NOM_DATASET];
+    int    shmid;
+    size_t octets;
+} passationDataset_t;
+
+/**********************************************************************/
+/* Envoi des jeux prêts sur le descripteur "fd" (redémarrage)         */
+/**********************************************************************/
+void exporterDatasets(int fd) {
+    for (int i=0; i<NB_MAX_DATASETS; i++) {
+        if (!registre[i].utilise
+            || __atomic_load_n(&registre[i].seg->etat, __ATOMIC_ACQUIRE) != DATASET_PRET) continue;
+        passationDataset_t p;
+        memset(&p, 0, sizeof(p));
+        memcpy(p.nom, registre[i].nom, TAILLE_NOM_DATASET);
+        p.shmid  = registre[i].shmid;
+        p.octets = registre[i].octets;
+        if (write(fd, &p, sizeof(p)) != sizeof(p)) return;
+    }
+} //----------------------------------------------------------------------
+
+/* Nombre de jeux dont le dépôt n'est pas terminé: ils ne peuvent pas
+   être passés à un nouveau serveur
+   ************************************************************************/
+int depotsEnCours(void) {
+    int nb = 0;
+    for (int i=0; i<NB_MAX_DATASETS; i++) {
+        if (registre[i].utilise
+            && __atomic_load_n(&registre[i].seg->etat, __ATOMIC_ACQUIRE) == DATASET_EN_DEPOT) nb++;
+    }
+    return nb;
+} //----------------------------------------------------------------------
+
+/**********************************************************************/
+/* Réception des jeux envoyés par l'ancien serveur jusqu'à la fin de  */
+/* "fd", renvoie le nombre de jeux rattachés                          */
+/**********************************************************************/
+int importerDatasets(int fd) {
+    passationDataset_t p;
+    int nbJeux = 0;
+    while (read(fd, &p, sizeof(p)) == sizeof(p)) {
+        int libre;
+        for (libre=0; libre<NB_MAX_DATASETS && registre[libre].utilise; libre++);
+        if (libre == NB_MAX_DATASETS) break;
+
+        struct datasetseg *seg = shmat(p.shmid, NULL, 0);
+        if (seg == (void *) -1) {
+            fprintf(stderr, "Jeu de données \"%.*s\" perdu: %s\n", TAILLE_NOM_DATASET, p.nom, strerror(errno));
+            continue;
+        }
+        dataset_t *d = &registre[libre];
+        memset(d, 0, sizeof(*d));
+        d->utilise      = TRUE;
+        memcpy(d->nom, p.nom, TAILLE_NOM_DATASET);
+        d->nom[TAILLE_NOM_DATASET - 1] = '\0';
+        d->shmid        = p.shmid;
+        d->seg          = seg;
+        d->octets       = p.octets;
+        d->dernierAcces = ++horloge;
+        octetsUtilises += p.octets;
+        nbJeux++;
+    }
+    return nbJeux;
+} //----------------------------------------------------------------------
+
+/**********************************************************************/
+/* Publication des jeux disponibles: une ligne "nom nbValeurs" par    */
+/* jeu prêt. Un jeu en cours de dépôt ou dont le dépôt a échoué n'est */
+/* pas publié. Le catalogue est écrit dans un fichier temporaire puis */
+/* renommé, un client ne lit donc jamais un catalogue incomplet.      */
+/**********************************************************************/
+void ecrireCatalogueDatasets(const char *fichier) {
+    char temporaire[512];
+    snprintf(temporaire, sizeof(temporaire), "%s.tmp", fichier);
+    FILE *f = fopen(temporaire, "w");
+    if (f == NULL) {
+        fprintf(stderr, "Impossible d'écrire le catalogue %s: %s\n", fichier, strerror(errno));
+        return;
+    }
+    for (int i=0; i<NB_MAX_DATASETS; i++) {
+        if (registre[i].utilise
+            && __atomic_load_n(&registre[i].seg->etat, __ATOMIC_ACQUIRE) == DATASET_PRET) {
+            fprintf(f, "%s %d\n", registre[i].nom, registre[i].seg->nbValeurs);
+        }
+    }
+    fclose(f);
+    rename(temporaire, fichier);
+} //----------------------------------------------------------------------
+
+/**********************************************************************/
+/* Côté client: nombre de valeurs du jeu "nom" d'après le catalogue,  */
+/* ou -1 si le jeu n'y figure pas                                     */
+/**********************************************************************/
+int lireTailleDataset(const char *fichier, const char *nom) {
+    FILE *f = fopen(fichier, "r");
+    if (f == NULL) return -1;
+
+    char lu[TAILLE_NOM_DATASET];
+    int nbValeurs, trouve = -1;
+    while (fscanf(f, "%31s %d", lu, &nbValeurs) == 2) {
+        if (strncmp(lu, nom, TAILLE_NOM_DATASET) == 0) trouve = nbValeurs;
+    }
+    fclose(f);
+    return trouve;
+}
@@ -0,0 +1,32 @@
+/**
+ * datasets.h
+ *
+ *  Created on: 23 déc. 2022
+ *      Author: Bouzidi Louisa et Dia Modou Ndiar
+ *
+ *  Jeux de données nommés gardés en mémoire partagée par le serveur.
+ */
+
+#ifndef DATASETS_H_
+#define DATASETS_H_
+
+#include "conf.h"
+
+// Côté serveur (processus père)
+int  creerDataset(const char *nom, int nbValeurs);
+int  trouverDataset(const char *nom);
+void prendreDataset(int i);
+void relacherDataset(int i);
+struct datasetseg *segmentDataset(int i);
+size_t octetsDataset(int i);
+void ecrireCatalogueDatasets(const char *fichier);
+void fixerCapaciteDatasets(size_t octets);
+void etatDatasets(int *nbJeux, size_t *octets, size_t *capaciteMax);
+int  depotsEnCours(void);
+void exporterDatasets(int fd);
+int  importerDatasets(int fd);
+
+// Côté client
+int  lireTailleDataset(const char *fichier, const char *nom);
+
+#endif /* DATASETS_H_ */
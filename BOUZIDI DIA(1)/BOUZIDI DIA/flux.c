@@ -0,0 +1,301 @@
+/**
+ * \file flux.c
+ * \brief Calcul en flux (hors mémoire) des sommes préfixées d'un fichier.
+ * \author Louisa BOUZIDI et Modou Ndiar DIA
+ * \version 0.1
+ * \date 28 decembre 2022
+ *
+ * Le traitement est découpé en trois threads qui se passent des blocs de
+ * valeurs à travers un tampon circulaire borné de NB_BLOCS_FLUX blocs:
+ *   ---> le lecteur lit et décode le bloc k+1 depuis le fichier d'entrée
+ *   ---> le calculateur applique l'opération au bloc k avec la retenue
+ *        (dernier résultat) du bloc k-1
+ *   ---> l'écrivain écrit le bloc k-1 dans le fichier de sortie
+ * La mémoire utilisée ne dépend donc pas de la taille du fichier.
+ * Pour une opération dont les éléments font plusieurs entiers (plugins),
+ * chaque bloc contient un nombre entier d'éléments.
+ * Le calcul par blocs exige une opération associative: la soustraction,
+ * que le serveur calcule avec Hills Steel Scan, est refusée plutôt que de
+ * donner un résultat différent de celui du serveur.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
+#include "conf.h"
+#include "operations.h"
+#include "flux.h"
+
+// Etats d'un bloc du tampon circulaire
+// ************************************
+#define BLOC_LIBRE   0      // le bloc peut être rempli par le lecteur
+#define BLOC_LU      1      // le bloc attend d'être calculé
+#define BLOC_CALCULE 2      // le bloc attend d'être écrit
+
+typedef struct blocFlux_t blocFlux_t;
+typedef struct flux_t flux_t;
+
+struct blocFlux_t {
+    int *valeurs;
+    int  nb;            // nombre d'entiers dans le bloc
+    int  dernier;       // TRUE si c'est le dernier bloc du fichier
+    int  etat;
+};
+
+struct flux_t {
+    blocFlux_t      blocs[NB_BLOCS_FLUX];
+    pthread_mutex_t verrou;
+    pthread_cond_t  changement;
+    FILE           *entree;
+    FILE           *sortie;
+    int             operation;
+    int             capacite;       // entiers par bloc, multiple de la taille d'un élément
+    int             erreur;
+    long long       nbValeurs;
+};
+
+/**********************************************************************/
+/* Attente que le bloc "k" du tampon circulaire soit dans l'état      */
+/* "attendu". Renvoie NULL si un autre thread a signalé une erreur.   */
+/**********************************************************************/
+static blocFlux_t *attendreBloc(flux_t *f, long long k, int attendu) {
+    blocFlux_t *b = &f->blocs[k % NB_BLOCS_FLUX];
+    pthread_mutex_lock(&f->verrou);
+    while (b->etat != attendu && !f->erreur) {
+        pthread_cond_wait(&f->changement, &f->verrou);
+    }
+    int erreur = f->erreur;
+    pthread_mutex_unlock(&f->verrou);
+    return erreur ? NULL : b;
+} //----------------------------------------------------------------------
+
+static void publierBloc(flux_t *f, blocFlux_t *b, int etat) {
+    pthread_mutex_lock(&f->verrou);
+    b->etat = etat;
+    pthread_cond_broadcast(&f->changement);
+    pthread_mutex_unlock(&f->verrou);
+} //----------------------------------------------------------------------
+
+static void signalerErreur(flux_t *f) {
+    pthread_mutex_lock(&f->verrou);
+    f->erreur = TRUE;
+    pthread_cond_broadcast(&f->changement);
+    pthread_mutex_unlock(&f->verrou);
+} //----------------------------------------------------------------------
+
+/* Thread lecteur : décode les entiers (séparés par des espaces ou des
+   retours à la ligne) par blocs d'au plus TAILLE_BLOC_FLUX valeurs. Un entier
+   peut être coupé entre deux lectures, l'état du décodage est donc
+   conservé d'une lecture à l'autre.
+   ************************************************************************/
+static void *lecteur(void *arg) {
+    flux_t *f = (flux_t *)arg;
+    char *tampon = malloc(TAILLE_TAMPON_FLUX);
+    if (tampon == NULL) {
+        signalerErreur(f);
+        return NULL;
+    }
+
+    size_t lus = 0, pos = 0;
+    long valeur = 0;
+    int signe = 1, enCours = FALSE, fin = FALSE;
+
+    for (long long k=0; !fin; k++) {
+        blocFlux_t *b = attendreBloc(f, k, BLOC_LIBRE);
+        if (b == NULL) break;
+
+        b->nb = 0;
+        while (b->nb < f->capacite) {
+            if (pos == lus) {
+                lus = fread(tampon, 1, TAILLE_TAMPON_FLUX, f->entree);
+                pos = 0;
+                if (lus == 0) {
+                    if (ferror(f->entree)) {
+                        fprintf(stderr, "Erreur de lecture du fichier: %s\n", strerror(errno));
+                        signalerErreur(f);
+                        free(tampon);
+                        return NULL;
+                    }
+                    if (enCours) b->valeurs[b->nb++] = (int)(signe * valeur);
+                    fin = TRUE;
+                    break;
+                }
+            }
+            char c = tampon[pos++];
+            if (c >= '0' && c <= '9') {
+                valeur  = valeur * 10 + (c - '0');
+                enCours = TRUE;
+            } else if (c == '-' && !enCours) {
+                signe = -1;
+            } else if (enCours) {
+                b->valeurs[b->nb++] = (int)(signe * valeur);
+                valeur  = 0;
+                signe   = 1;
+                enCours = FALSE;
+            } else {
+                signe = 1;
+            }
+        }
+        b->dernier = fin;
+        publierBloc(f, b, BLOC_LU);
+    }
+    free(tampon);
+    return NULL;
+} //----------------------------------------------------------------------
+
+/* Thread calculateur : préfixe de chaque bloc avec la retenue du bloc
+   précédent
+   ************************************************************************/
+static void *calculateur(void *arg) {
+    flux_t *f = (flux_t *)arg;
+    int t = tailleElement(f->operation);
+    int retenue[TAILLE_MAX_ELEMENT];
+    int aRetenue = FALSE, dernier = FALSE;
+
+    for (long long k=0; !dernier; k++) {
+        blocFlux_t *b = attendreBloc(f, k, BLOC_LU);
+        if (b == NULL) break;
+
+        if (b->nb % t != 0) {
+            fprintf(stderr, "Le nombre de valeurs n'est pas un multiple de %d\n", t);
+            signalerErreur(f);
+            break;
+        }
+        int nbElements = b->nb / t;
+        scanSequentiel(f->operation, b->valeurs, nbElements, aRetenue ? retenue : NULL);
+        if (nbElements > 0) {
+            memcpy(retenue, &b->valeurs[(nbElements - 1) * t], t * sizeof(int));
+            aRetenue = TRUE;
+        }
+        f->nbValeurs += b->nb;
+        dernier = b->dernier;
+        publierBloc(f, b, BLOC_CALCULE);
+    }
+    return NULL;
+} //----------------------------------------------------------------------
+
+/* Conversion rapide d'un entier en texte, renvoie le nombre de caractères
+   ************************************************************************/
+static int ecrireEntier(char *dst, int v) {
+    char tmp[12];
+    int n = 0, lg = 0;
+    unsigned int u = (v < 0) ? -(unsigned int)v : (unsigned int)v;
+    do {
+        tmp[n++] = '0' + u % 10;
+        u /= 10;
+    } while (u != 0);
+    if (v < 0) dst[lg++] = '-';
+    while (n > 0) dst[lg++] = tmp[--n];
+    return lg;
+} //----------------------------------------------------------------------
+
+/* Thread écrivain : écrit chaque bloc calculé au même format que les
+   fichiers de données (valeurs séparées par des espaces) puis rend le
+   bloc au lecteur
+   ************************************************************************/
+static void *ecrivain(void *arg) {
+    flux_t *f = (flux_t *)arg;
+    // 11 caractères au plus par entier plus le séparateur
+    char *texte = malloc((size_t)TAILLE_BLOC_FLUX * 12 + 1);
+    if (texte == NULL) {
+        signalerErreur(f);
+        return NULL;
+    }
+    int premier = TRUE, dernier = FALSE;
+
+    for (long long k=0; !dernier; k++) {
+        blocFlux_t *b = attendreBloc(f, k, BLOC_CALCULE);
+        if (b == NULL) break;
+
+        size_t lg = 0;
+        for (int i=0; i<b->nb; i++) {
+            if (!premier) texte[lg++] = ' ';
+            lg += ecrireEntier(&texte[lg], b->valeurs[i]);
+            premier = FALSE;
+        }
+        dernier = b->dernier;
+        if (dernier) texte[lg++] = '\n';
+
+        if (fwrite(texte, 1, lg, f->sortie) != lg) {
+            fprintf(stderr, "Erreur d'écriture du résultat: %s\n", strerror(errno));
+            signalerErreur(f);
+            break;
+        }
+        publierBloc(f, b, BLOC_LIBRE);
+    }
+    free(texte);
+    return NULL;
+} //----------------------------------------------------------------------
+
+/**********************************************************************/
+/* Calcul en flux du fichier "entree" avec l'opération "operation",   */
+/* le résultat est écrit dans le fichier "sortie".                    */
+/**********************************************************************/
+int traitementFlux(const char *entree, int operation, const char *sortie) {
+    if (!estAssociative(operation)) {
+        fprintf(stderr, "L'opération %s n'est pas associative: elle ne peut pas être calculée "
+                "par blocs en mode flux\n", descripteurOperation(operation)->nom);
+        return EXIT_FAILURE;
+    }
+
+    flux_t f;
+    memset(&f, 0, sizeof(f));
+    f.operation = operation;
+    f.capacite  = TAILLE_BLOC_FLUX / tailleElement(operation) * tailleElement(operation);
+
+    f.entree = fopen(entree, "r");
+    if (f.entree == NULL) {
+        fprintf(stderr, "Impossible d'ouvrir le fichier %s: %s\n", entree, strerror(errno));
+        return EXIT_FAILURE;
+    }
+    f.sortie = fopen(sortie, "w");
+    if (f.sortie == NULL) {
+        fprintf(stderr, "Impossible de créer le fichier %s: %s\n", sortie, strerror(errno));
+        fclose(f.entree);
+        return EXIT_FAILURE;
+    }
+    setvbuf(f.sortie, NULL, _IOFBF, TAILLE_TAMPON_FLUX);
+
+    for (int i=0; i<NB_BLOCS_FLUX; i++) {
+        f.blocs[i].valeurs = malloc(TAILLE_BLOC_FLUX * sizeof(int));
+        f.blocs[i].etat    = BLOC_LIBRE;
+        if (f.blocs[i].valeurs == NULL) f.erreur = TRUE;
+    }
+    pthread_mutex_init(&f.verrou, NULL);
+    pthread_cond_init(&f.changement, NULL);
+
+    struct timespec debut, fin;
+    clock_gettime(CLOCK_MONOTONIC, &debut);
+
+    if (!f.erreur) {
+        pthread_t tLecteur, tCalculateur, tEcrivain;
+        pthread_create(&tLecteur, NULL, lecteur, &f);
+        pthread_create(&tCalculateur, NULL, calculateur, &f);
+        pthread_create(&tEcrivain, NULL, ecrivain, &f);
+        pthread_join(tLecteur, NULL);
+        pthread_join(tCalculateur, NULL);
+        pthread_join(tEcrivain, NULL);
+    }
+
+    if (fclose(f.sortie) != 0) f.erreur = TRUE;
+    fclose(f.entree);
+    clock_gettime(CLOCK_MONOTONIC, &fin);
+
+    for (int i=0; i<NB_BLOCS_FLUX; i++) free(f.blocs[i].valeurs);
+    pthread_mutex_destroy(&f.verrou);
+    pthread_cond_destroy(&f.changement);
+
+    if (f.erreur) {
+        fprintf(stderr, "Le calcul en flux de %s a échoué\n", entree);
+        return EXIT_FAILURE;
+    }
+
+    double duree = (fin.tv_sec - debut.tv_sec) + (fin.tv_nsec - debut.tv_nsec) / 1e9;
+    printf("\n==> Flux terminé : %lld valeurs calculées en %.3f s", f.nbValeurs, duree);
+    if (duree > 0) printf(" (%.1f Mvaleurs/s)", f.nbValeurs / duree / 1e6);
+    printf("\n==> Résultat écrit dans le fichier %s\n", sortie);
+    return EXIT_SUCCESS;
+}
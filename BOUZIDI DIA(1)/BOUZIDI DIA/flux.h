@@ -0,0 +1,19 @@
+/**
+ * flux.h
+ *
+ *  Created on: 23 déc. 2022
+ *      Author: Bouzidi Louisa et Dia Modou Ndiar
+ *
+ *  Mode flux : calcul des sommes préfixées d'un fichier de données plus
+ *  grand que la mémoire disponible. Le fichier est lu par blocs de
+ *  TAILLE_BLOC_FLUX valeurs, chaque bloc est calculé avec la retenue du
+ *  bloc précédent puis écrit dans le fichier de sortie. Seules les
+ *  opérations associatives sont acceptées.
+ */
+
+#ifndef FLUX_H_
+#define FLUX_H_
+
+int traitementFlux(const char *entree, int operation, const char *sortie);
+
+#endif /* FLUX_H_ */
@@ -0,0 +1,231 @@
+/**
+ * \file operations.c
+ * \brief Opérations associatives appliquées par les workers et le mode flux.
+ * \author Louisa BOUZIDI et Modou Ndiar DIA
+ * \version 0.1
+ * \date 28 decembre 2022
+ *
+ * Ce fichier contient aussi le catalogue des opérations: les 6 opérations
+ * de base suivies de celles enregistrées par les plugins (plugins.c).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include "conf.h"
+#include "operations.h"
+
+// Catalogue des opérations, indexé par le numéro de l'opération
+// *************************************************************
+static operation_t catalogue[NB_MAX_OPERATIONS + 1] = {
+    [ADDITION]       = {ADDITION,       "addition",       1, {0},       NULL, NULL},
+    [SOUSTRACTION]   = {SOUSTRACTION,   "soustraction",   1, {0},       NULL, NULL},
+    [MULTIPLICATION] = {MULTIPLICATION, "multiplication", 1, {1},       NULL, NULL},
+    [MAXIMUM]        = {MAXIMUM,        "maximum",        1, {INT_MIN}, NULL, NULL},
+    [MINIMUM]        = {MINIMUM,        "minimum",        1, {INT_MAX}, NULL, NULL},
+    [PGCD]           = {PGCD,           "pgcd",           1, {0},       NULL, NULL},
+};
+static int numeroMax = NB_OPERATIONS;     // plus grand numéro enregistré
+
+/* PGCD par l'algorithme d'Euclide : même résultat que la version par
+   soustractions successives sur des entiers positifs, mais termine aussi
+   lorsqu'une des valeurs est nulle ou négative
+   ************************************************************************/
+int pgcd(int a, int b) {
+    a = abs(a);
+    b = abs(b);
+    while (b != 0) {
+        int r = a % b;
+        a = b;
+        b = r;
+    }
+    return a;
+}//-------------------------------------
+
+int appliquerOperation(int operation, int recent, int ancien) {
+    switch (operation) {
+    case ADDITION:       return recent + ancien;
+    case SOUSTRACTION:   return recent - ancien;
+    case MULTIPLICATION: return recent * ancien;
+    case MAXIMUM:        return (recent > ancien) ? recent : ancien;
+    case MINIMUM:        return (recent < ancien) ? recent : ancien;
+    case PGCD:           return pgcd(recent, ancien);
+    }
+    return recent;
+}//-------------------------------------
+
+/* Combinaison de deux éléments, quelle que soit leur taille. "resultat"
+   peut être confondu avec "recent" ou "ancien".
+   ***************************************************************************/
+void combinerElements(int operation, int *resultat, const int *recent, const int *ancien) {
+    if (operation <= NB_OPERATIONS || catalogue[operation].combiner == NULL) {
+        *resultat = appliquerOperation(operation, *recent, *ancien);
+        return;
+    }
+    int tmp[TAILLE_MAX_ELEMENT];
+    catalogue[operation].combiner(tmp, recent, ancien);
+    memcpy(resultat, tmp, catalogue[operation].taille * sizeof(int));
+}//-------------------------------------
+
+/* Calcul séquentiel du préfixe de "nb" valeurs lues dans "source" et
+   écrites dans "data" ("source" peut être "data" pour un calcul en place).
+   Si "retenue" n'est pas NULL, elle contient le résultat du dernier
+   élément du bloc précédent et est combinée avec le premier élément.
+   Le switch est sorti des boucles pour que chacune reste une simple
+   récurrence que le compilateur sait optimiser.
+   ***************************************************************************/
+void scanSequentielDepuis(int operation, const int *source, int *data, int nb, const int *retenue) {
+    if (nb <= 0) return;
+    int t = tailleElement(operation);
+    if (retenue != NULL) {
+        combinerElements(operation, &data[0], &source[0], retenue);
+    } else if (source != data) {
+        memcpy(data, source, t * sizeof(int));
+    }
+    switch (operation) {
+    case ADDITION:
+        for (int i=1; i<nb; i++) data[i] = source[i] + data[i-1];
+        break;
+    case SOUSTRACTION:
+        for (int i=1; i<nb; i++) data[i] = source[i] - data[i-1];
+        break;
+    case MULTIPLICATION:
+        for (int i=1; i<nb; i++) data[i] = source[i] * data[i-1];
+        break;
+    case MAXIMUM:
+        for (int i=1; i<nb; i++) data[i] = (source[i] > data[i-1]) ? source[i] : data[i-1];
+        break;
+    case MINIMUM:
+        for (int i=1; i<nb; i++) data[i] = (source[i] < data[i-1]) ? source[i] : data[i-1];
+        break;
+    default:
+        for (int i=1; i<nb; i++) {
+            combinerElements(operation, &data[i*t], &source[i*t], &data[(i-1)*t]);
+        }
+        break;
+    }
+}//-------------------------------------
+
+void scanSequentiel(int operation, int *data, int nb, const int *retenue) {
+    scanSequentielDepuis(operation, data, data, nb, retenue);
+}//-------------------------------------
+
+/* Combinaison de chaque valeur d'un bloc déjà préfixé avec la retenue des
+   blocs qui le précèdent (seconde passe des calculs par blocs)
+   ***************************************************************************/
+void appliquerRetenue(int operation, int *data, int nb, const int *retenue) {
+    int r = *retenue;
+    switch (operation) {
+    case ADDITION:
+        for (int i=0; i<nb; i++) data[i] = data[i] + r;
+        break;
+    case MULTIPLICATION:
+        for (int i=0; i<nb; i++) data[i] = data[i] * r;
+        break;
+    case MAXIMUM:
+        for (int i=0; i<nb; i++) data[i] = (data[i] > r) ? data[i] : r;
+        break;
+    case MINIMUM:
+        for (int i=0; i<nb; i++) data[i] = (data[i] < r) ? data[i] : r;
+        break;
+    default: {
+        int t = tailleElement(operation);
+        for (int i=0; i<nb; i++) combinerElements(operation, &data[i*t], &data[i*t], retenue);
+        break;
+    }
+    }
+}//-------------------------------------
+
+/* La soustraction n'est pas associative: son préfixe ne peut pas être
+   découpé en blocs calculés séparément puis recombinés. Les plugins
+   doivent fournir des opérations associatives.
+   ***************************************************************************/
+int estAssociative(int operation) {
+    return operation != SOUSTRACTION;
+}//-------------------------------------
+
+/**********************************************************************/
+/* Gestion du catalogue des opérations                                */
+/**********************************************************************/
+
+/* Ajoute une opération au catalogue sous son propre numéro op->code et
+   renvoie ce numéro, ou -1 s'il est hors de la plage des plugins ou déjà
+   pris. Les numéros ne dépendent donc pas de l'ordre de chargement.
+   ***************************************************************************/
+int enregistrerOperation(const operation_t *op) {
+    if (op->code <= NB_OPERATIONS || op->code > NB_MAX_OPERATIONS) return -1;
+    if (operationExiste(op->code)) return -1;
+    catalogue[op->code] = *op;
+    if (op->code > numeroMax) numeroMax = op->code;
+    return op->code;
+}//-------------------------------------
+
+/* Numéro de l'opération portant ce nom, ou -1
+   ***************************************************************************/
+int chercherOperation(const char *nom) {
+    for (int op=1; op<=numeroMax; op++) {
+        if (operationExiste(op) && strcmp(catalogue[op].nom, nom) == 0) return op;
+    }
+    return -1;
+}//-------------------------------------
+
+const operation_t *descripteurOperation(int operation) {
+    if (!operationExiste(operation)) return NULL;
+    return &catalogue[operation];
+}//-------------------------------------
+
+int operationExiste(int operation) {
+    // le catalogue peut avoir des trous: un numéro libre a un code nul
+    return operation >= 1 && operation <= numeroMax && catalogue[operation].code == operation;
+}//-------------------------------------
+
+int tailleElement(int operation) {
+    if (!operationExiste(operation)) return 1;
+    return catalogue[operation].taille;
+}//-------------------------------------
+
+int numeroMaxOperation(void) {
+    return numeroMax;
+}//-------------------------------------
+
+/* Le catalogue est publié par le serveur dans un fichier texte, une ligne
+   par opération : "numéro taille nom". Le client et le programme de
+   contrôle le relisent pour connaître les opérations des plugins.
+   ***************************************************************************/
+int ecrireCatalogue(const char *fichier) {
+    FILE *f = fopen(fichier, "w");
+    if (f == NULL) {
+        perror("Catalogue des opérations");
+        return EXIT_FAILURE;
+    }
+    for (int op=1; op<=numeroMax; op++) {
+        if (!operationExiste(op)) continue;
+        fprintf(f, "%d %d %s\n", op, catalogue[op].taille, catalogue[op].nom);
+    }
+    fclose(f);
+    return EXIT_SUCCESS;
+}//-------------------------------------
+
+/* Seuls le numéro, la taille et le nom sont relus: les opérations ainsi
+   enregistrées ne peuvent pas être calculées par ce processus. Le fichier
+   est lu ligne par ligne pour qu'une ligne incorrecte ne masque pas les
+   suivantes.
+   ***************************************************************************/
+int lireCatalogue(const char *fichier) {
+    FILE *f = fopen(fichier, "r");
+    if (f == NULL) return EXIT_FAILURE;
+
+    char ligne[128];
+    while (fgets(ligne, sizeof(ligne), f) != NULL) {
+        operation_t op;
+        memset(&op, 0, sizeof(op));
+        char reste;
+        if (sscanf(ligne, "%d %d %31s %c", &op.code, &op.taille, op.nom, &reste) != 3) continue;
+        if (operationExiste(op.code)) continue;     // déjà connue
+        if (op.taille < 1 || op.taille > TAILLE_MAX_ELEMENT) continue;
+        enregistrerOperation(&op);
+    }
+    fclose(f);
+    return EXIT_SUCCESS;
+}//-------------------------------------
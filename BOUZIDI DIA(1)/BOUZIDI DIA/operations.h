@@ -0,0 +1,51 @@
+/**
+ * operations.h
+ *
+ *  Created on: 23 déc. 2022
+ *      Author: Bouzidi Louisa et Dia Modou Ndiar
+ *
+ *  Opérations de calcul associatives partagées par le serveur, ses workers
+ *  et le mode flux. Par convention (celle de l'algorithme de Hills Steel
+ *  Scan du serveur), le premier opérande est l'élément le plus récent et le
+ *  second le préfixe déjà calculé : resultat[i] = data[i] op resultat[i-1].
+ *
+ *  Un élément est composé de "taille" entiers consécutifs: 1 pour les
+ *  opérations de base, plus pour certaines opérations des plugins (par
+ *  exemple 2 pour la composition de fonctions affines). Les "nb" des
+ *  fonctions ci-dessous sont des nombres d'éléments.
+ */
+
+#ifndef OPERATIONS_H_
+#define OPERATIONS_H_
+
+#include "conf.h"
+
+typedef struct operation_t operation_t;
+
+struct operation_t {
+    int  code;
+    char nom[TAILLE_NOM_OPERATION];
+    int  taille;                            // nombre d'entiers par élément
+    int  identite[TAILLE_MAX_ELEMENT];      // élément neutre
+    void (*combiner)(int *resultat, const int *recent, const int *ancien);
+    void (*noyauBloc)(int *data, int nb, const int *retenue);  // optionnel
+};
+
+int  pgcd(int a, int b);
+int  appliquerOperation(int operation, int recent, int ancien);
+void combinerElements(int operation, int *resultat, const int *recent, const int *ancien);
+void scanSequentiel(int operation, int *data, int nb, const int *retenue);
+void scanSequentielDepuis(int operation, const int *source, int *data, int nb, const int *retenue);
+void appliquerRetenue(int operation, int *data, int nb, const int *retenue);
+int  estAssociative(int operation);
+
+int  enregistrerOperation(const operation_t *op);
+const operation_t *descripteurOperation(int operation);
+int  operationExiste(int operation);
+int  tailleElement(int operation);
+int  numeroMaxOperation(void);
+int  chercherOperation(const char *nom);
+int  ecrireCatalogue(const char *fichier);
+int  lireCatalogue(const char *fichier);
+
+#endif /* OPERATIONS_H_ */
@@ -0,0 +1,293 @@
+/**
+ * \file planificateur.c
+ * \brief Choix de la stratégie d'exécution de chaque requête.
+ * \author Louisa BOUZIDI et Modou Ndiar DIA
+ * \version 0.1
+ * \date 28 decembre 2022
+ *
+ * Au démarrage, le serveur mesure (calibrerPlanificateur) le coût par élément
+ * de chaque moteur de scan.c et de chaque opération, ainsi que le coût de
+ * création d'un thread et d'un processus. Pour chaque requête, le
+ * planificateur estime ensuite la durée de chaque stratégie possible selon
+ * le nombre d'éléments et l'opération, et retient la moins coûteuse:
+ *   ---> sur les petits fichiers de Data/ la boucle séquentielle l'emporte
+ *        largement, la création d'un seul thread coûtant plus que le calcul
+ *   ---> sur les grands tableaux, le découpage en blocs sur plusieurs coeurs
+ *        devient rentable
+ * Les coûts sont mesurés par élément pour chaque opération, y compris celles
+ * des plugins: la taille des éléments est donc prise en compte.
+ * Les workers étant des fils du serveur, ils héritent des coefficients.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/wait.h>
+#include "conf.h"
+#include "operations.h"
+#include "scan.h"
+#include "planificateur.h"
+
+static const char *nomsPlans[NB_PLANS] = {
+    "auto", "sequentiel", "simd", "blocs", "distribue", "hillis-steele"
+};
+
+// Coefficients de coût, en nanosecondes. Les valeurs par défaut ne servent
+// que si le calibrage n'a pas été fait.
+// ***********************************************************************
+static struct {
+    int    nbCoeurs;
+    double sequentiel[NB_MAX_OPERATIONS + 1];   // par élément
+    double simd[NB_MAX_OPERATIONS + 1];         // par élément
+    double retenue[NB_MAX_OPERATIONS + 1];      // par élément, seconde passe des blocs
+    double thread;                              // création + attente d'un thread
+    double processus;                           // fork + waitpid d'un processus
+} coefs;
+
+static int threadsMax = 0;      // limite réglée par le programme de contrôle
+
+static long long maintenantNs(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (long long)t.tv_sec * 1000000000LL + t.tv_nsec;
+}
+
+static void *threadVide(void *arg) {
+    return arg;
+}
+
+static void coefficientsParDefaut(void) {
+    coefs.nbCoeurs = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (coefs.nbCoeurs < 1) coefs.nbCoeurs = 1;
+    for (int op=1; op<=NB_MAX_OPERATIONS; op++) {
+        coefs.sequentiel[op] = 1.0;
+        coefs.simd[op]       = 1.0;
+        coefs.retenue[op]    = 1.0;
+    }
+    coefs.thread    = 20000.0;
+    coefs.processus = 300000.0;
+}
+
+/**********************************************************************/
+/* Micro-benchmarks exécutés une fois au démarrage du serveur, après */
+/* le chargement des plugins. Chaque mesure est répétée et on garde   */
+/* la plus rapide pour limiter le bruit (cache, ordonnancement).      */
+/**********************************************************************/
+void calibrerPlanificateur(void) {
+    coefficientsParDefaut();
+
+    int *reference = malloc(TAILLE_CALIBRAGE * sizeof(int));
+    int *data      = malloc(TAILLE_CALIBRAGE * sizeof(int));
+    if (reference == NULL || data == NULL) {
+        free(reference);
+        free(data);
+        return;
+    }
+    for (int i=0; i<TAILLE_CALIBRAGE; i++) {
+        reference[i] = 1 + (i * 7919) % 97;
+    }
+
+    for (int op=1; op<=numeroMaxOperation(); op++) {
+        if (!operationExiste(op)) continue;
+        int nb = TAILLE_CALIBRAGE / tailleElement(op);
+        double seq = 1e30, simd = 1e30, ret = 1e30;
+        for (int essai=0; essai<3; essai++) {
+            memcpy(data, reference, TAILLE_CALIBRAGE * sizeof(int));
+            long long t0 = maintenantNs();
+            scanSequentiel(op, data, nb, NULL);
+            long long t1 = maintenantNs();
+            appliquerRetenue(op, data, nb, &reference[essai]);
+            long long t2 = maintenantNs();
+            memcpy(data, reference, TAILLE_CALIBRAGE * sizeof(int));
+            long long t3 = maintenantNs();
+            scanSIMD(op, data, data, nb, NULL);
+            long long t4 = maintenantNs();
+
+            if (t1 - t0 < seq)  seq  = t1 - t0;
+            if (t2 - t1 < ret)  ret  = t2 - t1;
+            if (t4 - t3 < simd) simd = t4 - t3;
+        }
+        coefs.sequentiel[op] = seq  / nb;
+        coefs.retenue[op]    = ret  / nb;
+        coefs.simd[op]       = simd / nb;
+    }
+    free(reference);
+    free(data);
+
+    double thread = 1e30;
+    for (int essai=0; essai<16; essai++) {
+        pthread_t t;
+        long long t0 = maintenantNs();
+        if (pthread_create(&t, NULL, threadVide, NULL) != 0) break;
+        pthread_join(t, NULL);
+        long long t1 = maintenantNs();
+        if (t1 - t0 < thread) thread = t1 - t0;
+    }
+    if (thread < 1e30) coefs.thread = thread;
+
+    double processus = 1e30;
+    for (int essai=0; essai<4; essai++) {
+        long long t0 = maintenantNs();
+        pid_t p = fork();
+        if (p == 0) _exit(EXIT_SUCCESS);
+        if (p < 0) break;
+        waitpid(p, NULL, 0);
+        long long t1 = maintenantNs();
+        if (t1 - t0 < processus) processus = t1 - t0;
+    }
+    if (processus < 1e30) coefs.processus = processus;
+
+    printf("\nCalibrage du planificateur (%d coeurs) : thread %.0f ns, processus %.0f ns\n",
+           coefs.nbCoeurs, coefs.thread, coefs.processus);
+    for (int op=1; op<=numeroMaxOperation(); op++) {
+        if (!operationExiste(op)) continue;
+        printf("   ---> opération %d (%s) : séquentiel %.2f ns, simd %.2f ns, retenue %.2f ns par élément\n",
+               op, descripteurOperation(op)->nom, coefs.sequentiel[op], coefs.simd[op], coefs.retenue[op]);
+    }
+}
+
+/* Durée estimée d'une stratégie pour "nb" éléments. Les plans "blocs" et
+   "distribue" sont exécutés sur "nbBlocs" blocs du pipeline du worker:
+   leurs threads ou processus sont lancés à chaque bloc
+   ************************************************************************/
+static double estimerCout(int strategie, int nbThreads, int operation, int nb, int nbBlocs) {
+    // au-delà du nombre de coeurs, les threads ne s'exécutent plus en parallèle
+    int paralleles = (nbThreads < coefs.nbCoeurs) ? nbThreads : coefs.nbCoeurs;
+    if (paralleles < 1) paralleles = 1;
+    double seq = coefs.sequentiel[operation];
+    double ret = coefs.retenue[operation];
+
+    switch (strategie) {
+    case PLAN_SEQUENTIEL:
+        return nb * seq;
+    case PLAN_SIMD:
+        return nb * coefs.simd[operation];
+    case PLAN_BLOCS:
+        return nbBlocs * nbThreads * coefs.thread + (double)nb / paralleles * (seq + ret);
+    case PLAN_DISTRIBUE:
+        return nbBlocs * (2 * nbThreads - 1) * coefs.processus + (double)nb / paralleles * (seq + ret);
+    case PLAN_HILLIS_STEELE: {
+        int nbEtapes = 0;
+        for (long long d=1; d<nb; d*=2) nbEtapes++;
+        return nbThreads * coefs.thread + (double)nbEtapes * nb / paralleles * seq;
+    }
+    }
+    return 1e30;
+}
+
+static void essayerPlan(plan_t *meilleur, int strategie, int nbThreads, int operation, int nb, int nbBlocs) {
+    double cout = estimerCout(strategie, nbThreads, operation, nb, nbBlocs);
+    if (cout < meilleur->cout) {
+        meilleur->strategie = strategie;
+        meilleur->nbThreads = nbThreads;
+        meilleur->cout      = cout;
+    }
+}
+
+/**********************************************************************/
+/* Limite du nombre de threads (ou processus) d'une requête, réglable */
+/* pendant l'exécution du serveur. 0 : pas d'autre limite que celle   */
+/* des coeurs et de NB_MAXI_THREADS.                                  */
+/**********************************************************************/
+void fixerThreadsMax(int nb) {
+    threadsMax = (nb > NB_MAXI_THREADS) ? NB_MAXI_THREADS : (nb < 0) ? 0 : nb;
+}
+
+int lireThreadsMax(void) {
+    return threadsMax;
+}
+
+/**********************************************************************/
+/* Choix du plan d'une requête. Le client peut imposer la stratégie   */
+/* (planDemande != PLAN_AUTO) et/ou le nombre de threads              */
+/* (nbThreadsDemandes > 0), le planificateur choisit le reste.        */
+/* "nbBlocs" : nombre de blocs sur lesquels un plan parallèle sera    */
+/* relancé (pipeline du worker).                                      */
+/**********************************************************************/
+plan_t choisirPlan(int operation, int nb, int planDemande, int nbThreadsDemandes, int nbBlocs) {
+    if (coefs.nbCoeurs == 0) coefficientsParDefaut();
+    if (nbBlocs < 1) nbBlocs = 1;
+    if (nbThreadsDemandes > NB_MAXI_THREADS) nbThreadsDemandes = NB_MAXI_THREADS;
+
+    int maxThreads = (nbThreadsDemandes > 0) ? nbThreadsDemandes : coefs.nbCoeurs;
+    if (threadsMax > 0 && maxThreads > threadsMax) maxThreads = threadsMax;
+    if (maxThreads > nb) maxThreads = nb;
+    if (maxThreads < 1) maxThreads = 1;
+
+    plan_t plan;
+    plan.cout = 1e300;
+
+    // la soustraction ne peut être découpée: seul le plan historique
+    // donne le même résultat qu'avant
+    if (!estAssociative(operation)) planDemande = PLAN_HILLIS_STEELE;
+    if (planDemande == PLAN_SIMD && !simdDisponible(operation)) planDemande = PLAN_SEQUENTIEL;
+
+    switch (planDemande) {
+    case PLAN_SEQUENTIEL:
+    case PLAN_SIMD:
+        essayerPlan(&plan, planDemande, 1, operation, nb, nbBlocs);
+        break;
+    case PLAN_BLOCS:
+    case PLAN_DISTRIBUE:
+    case PLAN_HILLIS_STEELE:
+        essayerPlan(&plan, planDemande, maxThreads, operation, nb, nbBlocs);
+        break;
+    default:
+        essayerPlan(&plan, PLAN_SEQUENTIEL, 1, operation, nb, nbBlocs);
+        if (simdDisponible(operation)) {
+            essayerPlan(&plan, PLAN_SIMD, 1, operation, nb, nbBlocs);
+        }
+        for (int t=(nbThreadsDemandes > 0) ? maxThreads : 2; t<=maxThreads; t++) {
+            if (t < 2) continue;
+            essayerPlan(&plan, PLAN_BLOCS, t, operation, nb, nbBlocs);
+            essayerPlan(&plan, PLAN_DISTRIBUE, t, operation, nb, nbBlocs);
+        }
+        break;
+    }
+    return plan;
+}
+
+/**********************************************************************/
+/* Exécution d'un plan: préfixe de "source" écrit dans "data" (le    */
+/* même tableau pour un calcul en place). Pour PLAN_DISTRIBUE, "data" */
+/* doit être en mémoire partagée (voir scanDistribue).                */
+/**********************************************************************/
+void executerPlan(const plan_t *plan, int operation, const int *source, int *data, int nb, const int *retenue) {
+    switch (plan->strategie) {
+    case PLAN_SIMD:
+        scanSIMD(operation, source, data, nb, retenue);
+        break;
+    case PLAN_BLOCS:
+        scanBlocs(operation, source, data, nb, retenue, plan->nbThreads);
+        break;
+    case PLAN_DISTRIBUE:
+        scanDistribue(operation, source, data, nb, retenue, plan->nbThreads);
+        break;
+    case PLAN_HILLIS_STEELE:
+        scanHillisSteele(operation, source, data, nb, plan->nbThreads);
+        break;
+    default:
+        scanSequentielDepuis(operation, source, data, nb, retenue);
+        break;
+    }
+}
+
+const char *nomPlan(int strategie) {
+    if (strategie < 0 || strategie >= NB_PLANS) return "inconnu";
+    return nomsPlans[strategie];
+}
+
+/* Le plan peut être donné par son nom ou par son numéro
+   ************************************************************************/
+int planDepuisNom(const char *nom) {
+    for (int p=0; p<NB_PLANS; p++) {
+        if (strcmp(nom, nomsPlans[p]) == 0) return p;
+    }
+    char *fin;
+    long p = strtol(nom, &fin, 10);
+    if (*nom != '\0' && *fin == '\0' && p >= 0 && p < NB_PLANS) return (int)p;
+    return -1;
+}
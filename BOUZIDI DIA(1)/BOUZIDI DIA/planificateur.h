@@ -0,0 +1,31 @@
+/**
+ * planificateur.h
+ *
+ *  Created on: 23 déc. 2022
+ *      Author: Bouzidi Louisa et Dia Modou Ndiar
+ *
+ *  Choix, pour chaque requête, de la stratégie d'exécution (PLAN_xxx de
+ *  conf.h) et du nombre de threads, à partir de coefficients de coût
+ *  mesurés par des micro-benchmarks au démarrage du serveur.
+ */
+
+#ifndef PLANIFICATEUR_H_
+#define PLANIFICATEUR_H_
+
+typedef struct plan_t plan_t;
+
+struct plan_t {
+    int    strategie;   // PLAN_SEQUENTIEL, PLAN_SIMD, ...
+    int    nbThreads;   // threads (ou processus pour PLAN_DISTRIBUE)
+    double cout;        // durée estimée en nanosecondes
+};
+
+void        calibrerPlanificateur(void);
+plan_t      choisirPlan(int operation, int nb, int planDemande, int nbThreadsDemandes, int nbBlocs);
+void        executerPlan(const plan_t *plan, int operation, const int *source, int *data, int nb, const int *retenue);
+void        fixerThreadsMax(int nb);
+int         lireThreadsMax(void);
+const char *nomPlan(int strategie);
+int         planDepuisNom(const char *nom);
+
+#endif /* PLANIFICATEUR_H_ */
@@ -0,0 +1,126 @@
+/**
+ * \file plugins.c
+ * \brief Chargement des plugins d'opérations avec dlopen.
+ * \author Louisa BOUZIDI et Modou Ndiar DIA
+ * \version 0.1
+ * \date 28 decembre 2022
+ *
+ * Chaque fichier .so du dossier des plugins est chargé et son opération
+ * est ajoutée au catalogue (operations.c) sous le numéro plugin_code
+ * qu'il exporte: ajouter ou retirer un plugin ne renumérote pas les
+ * autres. Un plugin incomplet ou invalide, ou dont le numéro est déjà
+ * pris par un plugin chargé avant lui (ordre alphabétique), est signalé
+ * puis ignoré, sans empêcher le démarrage du serveur.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <dirent.h>
+#include <dlfcn.h>
+#include "conf.h"
+#include "operations.h"
+#include "plugins.h"
+
+static int estBibliotheque(const struct dirent *e) {
+    size_t lg = strlen(e->d_name);
+    return lg > 3 && strcmp(e->d_name + lg - 3, ".so") == 0;
+}
+
+/* Le nom est écrit dans le catalogue publié et relu mot par mot: il ne doit
+   être ni vide, ni trop long, ni contenir d'espace. */
+static int nomValide(const char *nom) {
+    size_t lg = strnlen(nom, TAILLE_NOM_OPERATION);
+    if (lg == 0 || lg >= TAILLE_NOM_OPERATION) return 0;
+    for (size_t i=0; i<lg; i++) {
+        if (isspace((unsigned char)nom[i]) || !isprint((unsigned char)nom[i])) return 0;
+    }
+    return 1;
+}
+
+/**********************************************************************/
+/* Chargement d'un plugin, renvoie le numéro de son opération ou -1   */
+/**********************************************************************/
+static int chargerPlugin(const char *chemin) {
+    void *bibliotheque = dlopen(chemin, RTLD_NOW | RTLD_LOCAL);
+    if (bibliotheque == NULL) {
+        fprintf(stderr, "Plugin %s ignoré: %s\n", chemin, dlerror());
+        return -1;
+    }
+
+    const int  *numero   = dlsym(bibliotheque, "plugin_code");
+    const char *nom      = dlsym(bibliotheque, "plugin_nom");
+    const int  *taille   = dlsym(bibliotheque, "plugin_taille");
+    const int  *identite = dlsym(bibliotheque, "plugin_identite");
+    void *combiner       = dlsym(bibliotheque, "plugin_combiner");
+    void *noyau          = dlsym(bibliotheque, "plugin_noyau");   // optionnel
+
+    if (numero == NULL || nom == NULL || taille == NULL || identite == NULL || combiner == NULL) {
+        fprintf(stderr, "Plugin %s ignoré: symbole plugin_xxx manquant\n", chemin);
+        dlclose(bibliotheque);
+        return -1;
+    }
+    if (*numero <= NB_OPERATIONS || *numero > NB_MAX_OPERATIONS) {
+        fprintf(stderr, "Plugin %s ignoré: numéro %d hors de [%d, %d]\n",
+                chemin, *numero, NB_OPERATIONS + 1, NB_MAX_OPERATIONS);
+        dlclose(bibliotheque);
+        return -1;
+    }
+    if (operationExiste(*numero)) {
+        fprintf(stderr, "Plugin %s ignoré: numéro %d déjà pris par \"%s\"\n",
+                chemin, *numero, descripteurOperation(*numero)->nom);
+        dlclose(bibliotheque);
+        return -1;
+    }
+    if (!nomValide(nom)) {
+        fprintf(stderr, "Plugin %s ignoré: nom vide, trop long ou avec des espaces\n", chemin);
+        dlclose(bibliotheque);
+        return -1;
+    }
+    if (chercherOperation(nom) > 0) {
+        fprintf(stderr, "Plugin %s ignoré: nom \"%s\" déjà utilisé\n", chemin, nom);
+        dlclose(bibliotheque);
+        return -1;
+    }
+    if (*taille <= 0 || *taille % sizeof(int) != 0
+        || *taille / sizeof(int) > TAILLE_MAX_ELEMENT) {
+        fprintf(stderr, "Plugin %s ignoré: taille d'élément %d incorrecte\n", chemin, *taille);
+        dlclose(bibliotheque);
+        return -1;
+    }
+
+    operation_t op;
+    memset(&op, 0, sizeof(op));
+    op.code = *numero;
+    strncpy(op.nom, nom, sizeof(op.nom) - 1);
+    op.taille = *taille / sizeof(int);
+    memcpy(op.identite, identite, *taille);
+    op.combiner  = (void (*)(int *, const int *, const int *))combiner;
+    op.noyauBloc = (void (*)(int *, int, const int *))noyau;
+
+    int code = enregistrerOperation(&op);
+    printf("Plugin %s chargé: opération %d \"%s\" (%d entier(s) par élément%s)\n",
+           chemin, code, op.nom, op.taille, (noyau != NULL) ? ", noyau vectorisé" : "");
+    return code;
+}
+
+/**********************************************************************/
+/* Chargement de tous les plugins du dossier, renvoie leur nombre.    */
+/* Un dossier absent n'est pas une erreur: il n'y a pas de plugin.    */
+/**********************************************************************/
+int chargerPlugins(const char *dossier) {
+    struct dirent **fichiers;
+    int nbFichiers = scandir(dossier, &fichiers, estBibliotheque, alphasort);
+    if (nbFichiers < 0) return 0;
+
+    int nbCharges = 0;
+    for (int i=0; i<nbFichiers; i++) {
+        char chemin[512];
+        snprintf(chemin, sizeof(chemin), "%s/%s", dossier, fichiers[i]->d_name);
+        if (chargerPlugin(chemin) > 0) nbCharges++;
+        free(fichiers[i]);
+    }
+    free(fichiers);
+    return nbCharges;
+}
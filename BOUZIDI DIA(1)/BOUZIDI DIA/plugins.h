@@ -0,0 +1,15 @@
+/**
+ * plugins.h
+ *
+ *  Created on: 23 déc. 2022
+ *      Author: Bouzidi Louisa et Dia Modou Ndiar
+ *
+ *  Chargement des opérations définies par les plugins (plugins/plugin.h).
+ */
+
+#ifndef PLUGINS_H_
+#define PLUGINS_H_
+
+int chargerPlugins(const char *dossier);
+
+#endif /* PLUGINS_H_ */
@@ -0,0 +1,27 @@
+/**
+ * \file affine.c
+ * \brief Plugin de composition de fonctions affines.
+ * \author Louisa BOUZIDI et Modou Ndiar DIA
+ * \version 0.1
+ * \date 28 decembre 2022
+ *
+ * Un élément (a, b) représente la fonction x -> a*x + b. Le préfixe d'indice
+ * i est la composée f_i o ... o f_1 o f_0, qui donne par exemple en une seule
+ * requête l'état d'une récurrence linéaire u(i+1) = a_i*u(i) + b_i.
+ * Les calculs sont faits modulo 2^32.
+ */
+
+#include "plugin.h"
+
+const int  plugin_code       = 7;
+const char plugin_nom[]      = "affine";
+const int  plugin_taille     = 2 * sizeof(int);
+const int  plugin_identite[] = {1, 0};
+
+// (a2, b2) o (a1, b1) = (a2*a1, a2*b1 + b2)
+void plugin_combiner(int *resultat, const int *recent, const int *ancien) {
+    unsigned int a2 = recent[0], b2 = recent[1];
+    unsigned int a1 = ancien[0], b1 = ancien[1];
+    resultat[0] = (int)(a2 * a1);
+    resultat[1] = (int)(a2 * b1 + b2);
+}
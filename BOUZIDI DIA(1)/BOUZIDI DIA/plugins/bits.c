@@ -0,0 +1,50 @@
+/**
+ * \file bits.c
+ * \brief Plugins des opérations bit à bit OU, ET et OU exclusif.
+ * \author Louisa BOUZIDI et Modou Ndiar DIA
+ * \version 0.1
+ * \date 28 decembre 2022
+ *
+ * Le même fichier donne trois plugins selon la macro définie à la
+ * compilation (voir le makefile): OPERATION_OU, OPERATION_ET ou
+ * OPERATION_XOR.
+ */
+
+#include <stddef.h>
+#include "plugin.h"
+
+#if defined(OPERATION_OU)
+#define CODE    10
+#define NOM     "ou"
+#define NEUTRE  0
+#define OP(a,b) ((a) | (b))
+#elif defined(OPERATION_ET)
+#define CODE    8
+#define NOM     "et"
+#define NEUTRE  (~0)
+#define OP(a,b) ((a) & (b))
+#elif defined(OPERATION_XOR)
+#define CODE    11
+#define NOM     "xor"
+#define NEUTRE  0
+#define OP(a,b) ((a) ^ (b))
+#else
+#error "Définir OPERATION_OU, OPERATION_ET ou OPERATION_XOR"
+#endif
+
+const int  plugin_code       = CODE;
+const char plugin_nom[]      = NOM;
+const int  plugin_taille     = sizeof(int);
+const int  plugin_identite[] = {NEUTRE};
+
+void plugin_combiner(int *resultat, const int *recent, const int *ancien) {
+    *resultat = OP(*recent, *ancien);
+}
+
+void plugin_noyau(int *data, int nb, const int *retenue) {
+    int r = (retenue != NULL) ? *retenue : NEUTRE;
+    for (int i=0; i<nb; i++) {
+        r = OP(data[i], r);
+        data[i] = r;
+    }
+}
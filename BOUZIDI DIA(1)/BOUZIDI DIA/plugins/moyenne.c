@@ -0,0 +1,40 @@
+/**
+ * \file moyenne.c
+ * \brief Plugin de fusion de moyennes.
+ * \author Louisa BOUZIDI et Modou Ndiar DIA
+ * \version 0.1
+ * \date 28 decembre 2022
+ *
+ * Un élément (n, s) résume n mesures de somme s, leur moyenne étant s/n.
+ * Garder la somme plutôt que la moyenne rend la fusion exacte, donc
+ * associative, avec des entiers: le préfixe d'indice i donne la moyenne
+ * de tous les éléments jusqu'à i.
+ */
+
+#include <stddef.h>
+#include "plugin.h"
+
+const int  plugin_code       = 9;
+const char plugin_nom[]      = "moyenne";
+const int  plugin_taille     = 2 * sizeof(int);
+const int  plugin_identite[] = {0, 0};
+
+void plugin_combiner(int *resultat, const int *recent, const int *ancien) {
+    resultat[0] = (int)((unsigned int)recent[0] + (unsigned int)ancien[0]);
+    resultat[1] = (int)((unsigned int)recent[1] + (unsigned int)ancien[1]);
+}
+
+// Les deux composantes sont des sommes préfixées indépendantes
+void plugin_noyau(int *data, int nb, const int *retenue) {
+    unsigned int n = 0, s = 0;
+    if (retenue != NULL) {
+        n = retenue[0];
+        s = retenue[1];
+    }
+    for (int i=0; i<nb; i++) {
+        n += (unsigned int)data[2*i];
+        s += (unsigned int)data[2*i + 1];
+        data[2*i]     = (int)n;
+        data[2*i + 1] = (int)s;
+    }
+}
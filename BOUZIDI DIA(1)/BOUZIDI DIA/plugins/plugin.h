@@ -0,0 +1,45 @@
+/**
+ * plugin.h
+ *
+ *  Created on: 23 déc. 2022
+ *      Author: Bouzidi Louisa et Dia Modou Ndiar
+ *
+ *  Interface des plugins d'opérations. Un plugin est une bibliothèque
+ *  partagée (.so) déposée dans le dossier DOSSIER_PLUGINS du serveur,
+ *  qui exporte les symboles ci-dessous. Le serveur la charge avec dlopen
+ *  au démarrage et l'enregistre sous le numéro plugin_code qu'elle choisit:
+ *  ce numéro reste le même quels que soient les autres plugins présents.
+ *
+ *  Un élément est une suite de plugin_taille octets (un multiple de
+ *  sizeof(int), au plus TAILLE_MAX_ELEMENT entiers) lue comme autant
+ *  d'entiers consécutifs dans le fichier de données du client.
+ *
+ *  L'opération doit être associative. Comme pour les opérations de base,
+ *  "recent" est l'élément d'indice le plus grand et "ancien" le préfixe
+ *  qui le précède: l'opération n'a pas besoin d'être commutative.
+ */
+
+#ifndef PLUGIN_H_
+#define PLUGIN_H_
+
+// Numéro de l'opération, entre NB_OPERATIONS+1 (7) et NB_MAX_OPERATIONS (38),
+// propre à ce plugin. Un plugin dont le numéro est déjà pris est ignoré.
+extern const int plugin_code;
+
+// Nom de l'opération (31 caractères au plus, sans espace), unique lui aussi
+extern const char plugin_nom[];
+
+// Taille d'un élément en octets
+extern const int plugin_taille;
+
+// Elément neutre: plugin_taille octets
+extern const int plugin_identite[];
+
+// resultat = recent op ancien. "resultat" ne pointe jamais sur un opérande.
+void plugin_combiner(int *resultat, const int *recent, const int *ancien);
+
+// Optionnel : préfixe en place de "nb" éléments consécutifs, combinés avec
+// "retenue" (NULL pour le premier bloc). Utilisé par le plan "simd".
+void plugin_noyau(int *data, int nb, const int *retenue);
+
+#endif /* PLUGIN_H_ */
@@ -0,0 +1,339 @@
+/**
+ * \file scan.c
+ * \brief Moteurs de calcul des sommes préfixées utilisés par les workers.
+ * \author Louisa BOUZIDI et Modou Ndiar DIA
+ * \version 0.1
+ * \date 28 decembre 2022
+ *
+ * Chaque moteur correspond à une stratégie du planificateur:
+ *   ---> scanSequentiel (operations.c) : une simple boucle
+ *   ---> scanSIMD      : 4 valeurs à la fois dans un registre vectoriel
+ *   ---> scanBlocs     : chaque thread calcule le préfixe de son bloc, puis
+ *                        combine son bloc avec la retenue des blocs précédents
+ *   ---> scanDistribue : même découpage, mais chaque bloc est calculé par un
+ *                        processus fils. Les données doivent alors être en
+ *                        mémoire partagée (segment du client)
+ *   ---> scanHillisSteele : l'algorithme historique du serveur, seul à
+ *                        donner le même résultat pour une opération non
+ *                        associative comme la soustraction
+ * Les opérations des plugins ont des éléments de tailleElement(operation)
+ * entiers: l'élément i commence à data[i * taille].
+ * Les valeurs sont lues dans "source" et le préfixe écrit dans "data":
+ * "source" est "data" pour un calcul en place, ou un jeu de données en
+ * lecture seule que la première passe lit sans le recopier.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include "conf.h"
+#include "operations.h"
+#include "scan.h"
+
+/* Bornes [debut, fin[ du bloc "k" lorsque "nb" valeurs sont réparties
+   en "nbBlocs" blocs de tailles égales à une valeur près
+   ************************************************************************/
+static void bornesBloc(int nb, int nbBlocs, int k, int *debut, int *fin) {
+    *debut = (int)((long long)nb * k / nbBlocs);
+    *fin   = (int)((long long)nb * (k + 1) / nbBlocs);
+}
+
+/* Retenue du bloc "k" : combinaison des derniers éléments des blocs 0 à k-1
+   (le dernier élément du bloc 0 contient déjà la retenue de départ)
+   ************************************************************************/
+static void retenueBloc(int operation, const int *derniers, int k, int *retenue) {
+    int t = tailleElement(operation);
+    memcpy(retenue, derniers, t * sizeof(int));
+    for (int j=1; j<k; j++) {
+        combinerElements(operation, retenue, &derniers[j*t], retenue);
+    }
+}
+
+/* ====================================================================== */
+/*                       Moteur vectoriel (SIMD)                          */
+/* ====================================================================== */
+
+// Vecteur de 4 entiers (extension vectorielle de gcc, traduite en SSE/NEON)
+typedef int v4si __attribute__ ((vector_size (16)));
+
+static inline v4si additionV(v4si a, v4si b)       { return a + b; }
+static inline v4si multiplicationV(v4si a, v4si b) { return a * b; }
+static inline v4si maximumV(v4si a, v4si b) { v4si m = a > b; return (a & m) | (b & ~m); }
+static inline v4si minimumV(v4si a, v4si b) { v4si m = a < b; return (a & m) | (b & ~m); }
+
+/* Préfixe de 4 valeurs dans un registre en 2 décalages (élément neutre
+   inséré à gauche), puis combinaison avec la retenue diffusée sur les 4
+   valeurs. Les valeurs restantes (moins de 4) sont calculées en séquentiel.
+   ************************************************************************/
+#define DEFINIR_SCAN_SIMD(nom, operation, COMBINER, NEUTRE)                     \
+static void nom(const int *source, int *data, int nb, const int *retenue) {    \
+    const v4si neutre = {NEUTRE, NEUTRE, NEUTRE, NEUTRE};                        \
+    v4si report = neutre;                                                        \
+    if (retenue != NULL) report = (v4si){*retenue, *retenue, *retenue, *retenue}; \
+    int i = 0;                                                                   \
+    for (; i + 4 <= nb; i += 4) {                                                \
+        v4si v;                                                                  \
+        memcpy(&v, &source[i], sizeof(v));                                       \
+        v = COMBINER(v, __builtin_shuffle(v, neutre, (v4si){4, 0, 1, 2}));       \
+        v = COMBINER(v, __builtin_shuffle(v, neutre, (v4si){4, 5, 0, 1}));       \
+        v = COMBINER(v, report);                                                 \
+        memcpy(&data[i], &v, sizeof(v));                                         \
+        report = __builtin_shuffle(v, (v4si){3, 3, 3, 3});                       \
+    }                                                                            \
+    int r = report[0];                                                           \
+    scanSequentielDepuis(operation, &source[i], &data[i], nb - i, &r);           \
+}
+
+DEFINIR_SCAN_SIMD(scanAdditionSIMD,       ADDITION,       additionV,       0)
+DEFINIR_SCAN_SIMD(scanMultiplicationSIMD, MULTIPLICATION, multiplicationV, 1)
+DEFINIR_SCAN_SIMD(scanMaximumSIMD,        MAXIMUM,        maximumV,        INT_MIN)
+DEFINIR_SCAN_SIMD(scanMinimumSIMD,        MINIMUM,        minimumV,        INT_MAX)
+
+/* Les plugins peuvent fournir leur propre noyau vectorisé (noyauBloc)
+   ************************************************************************/
+int simdDisponible(int operation) {
+    const operation_t *op = descripteurOperation(operation);
+    return operation == ADDITION || operation == MULTIPLICATION
+        || operation == MAXIMUM  || operation == MINIMUM
+        || (op != NULL && op->noyauBloc != NULL);
+}
+
+void scanSIMD(int operation, const int *source, int *data, int nb, const int *retenue) {
+    const operation_t *op = descripteurOperation(operation);
+    switch (operation) {
+    case ADDITION:       scanAdditionSIMD(source, data, nb, retenue);       break;
+    case MULTIPLICATION: scanMultiplicationSIMD(source, data, nb, retenue); break;
+    case MAXIMUM:        scanMaximumSIMD(source, data, nb, retenue);        break;
+    case MINIMUM:        scanMinimumSIMD(source, data, nb, retenue);        break;
+    default:
+        if (op != NULL && op->noyauBloc != NULL) {
+            // le noyau d'un plugin ne calcule qu'en place
+            if (source != data) memcpy(data, source, (size_t)nb * op->taille * sizeof(int));
+            op->noyauBloc(data, nb, retenue);
+        } else {
+            scanSequentielDepuis(operation, source, data, nb, retenue);
+        }
+        break;
+    }
+}
+
+/* ====================================================================== */
+/*                  Moteur par blocs (plusieurs threads)                  */
+/* ====================================================================== */
+
+typedef struct bloc_t bloc_t;
+
+struct bloc_t {
+    int                operation;
+    const int         *source;
+    int               *data;
+    int                nb;
+    const int         *retenue;
+    int                nbBlocs;
+    int                indice;
+    int               *derniers;    // dernier élément de chaque bloc
+    pthread_barrier_t *barriere;
+};
+
+static void *calculBloc(void *arg) {
+    bloc_t *b = (bloc_t *)arg;
+    int t = tailleElement(b->operation);
+    int debut, fin;
+    bornesBloc(b->nb, b->nbBlocs, b->indice, &debut, &fin);
+
+    // Passe 1 : préfixe local du bloc
+    scanSequentielDepuis(b->operation, &b->source[debut*t], &b->data[debut*t], fin - debut,
+                         (b->indice == 0) ? b->retenue : NULL);
+    memcpy(&b->derniers[b->indice*t], &b->data[(fin-1)*t], t * sizeof(int));
+
+    // on attend que tous les blocs aient leur dernier élément
+    pthread_barrier_wait(b->barriere);
+
+    // Passe 2 : report de la retenue des blocs précédents
+    if (b->indice > 0) {
+        int retenue[TAILLE_MAX_ELEMENT];
+        retenueBloc(b->operation, b->derniers, b->indice, retenue);
+        appliquerRetenue(b->operation, &b->data[debut*t], fin - debut, retenue);
+    }
+    return NULL;
+}
+
+void scanBlocs(int operation, const int *source, int *data, int nb, const int *retenue, int nbThreads) {
+    if (nbThreads > nb) nbThreads = nb;
+    if (nbThreads > NB_MAXI_THREADS) nbThreads = NB_MAXI_THREADS;
+    if (nbThreads <= 1) {
+        scanSequentielDepuis(operation, source, data, nb, retenue);
+        return;
+    }
+
+    pthread_t Threads[NB_MAXI_THREADS];
+    bloc_t blocs[NB_MAXI_THREADS];
+    int derniers[NB_MAXI_THREADS * TAILLE_MAX_ELEMENT];
+    pthread_barrier_t barriere;
+    pthread_barrier_init(&barriere, NULL, nbThreads);
+
+    for (int k=0; k<nbThreads; k++) {
+        blocs[k].operation = operation;
+        blocs[k].source    = source;
+        blocs[k].data      = data;
+        blocs[k].nb        = nb;
+        blocs[k].retenue   = retenue;
+        blocs[k].nbBlocs   = nbThreads;
+        blocs[k].indice    = k;
+        blocs[k].derniers  = derniers;
+        blocs[k].barriere  = &barriere;
+        pthread_create(&Threads[k], NULL, calculBloc, &blocs[k]);
+    }
+    for (int k=0; k<nbThreads; k++) {
+        pthread_join(Threads[k], NULL);
+    }
+    pthread_barrier_destroy(&barriere);
+}
+
+/* ====================================================================== */
+/*               Moteur distribué (plusieurs processus fils)              */
+/* ====================================================================== */
+
+/* Précondition : "data" doit être en mémoire partagée avec les fils
+   (MAP_SHARED ou segment shmget, comme le segment du client utilisé par
+   le worker). Les fils calculent leur bloc directement dans "data": avec
+   un tableau privé (malloc, pile), leurs écritures sont faites dans leur
+   copie de l'espace d'adressage et le père garde les données non calculées.
+   "source" n'est que lu: il peut être privé ou en lecture seule.
+   ************************************************************************/
+void scanDistribue(int operation, const int *source, int *data, int nb, const int *retenue, int nbProcessus) {
+    if (nbProcessus > nb) nbProcessus = nb;
+    if (nbProcessus > NB_MAXI_THREADS) nbProcessus = NB_MAXI_THREADS;
+
+    // les derniers éléments des blocs sont rendus par les fils dans une
+    // petite zone partagée créée avant les fork()
+    int t = tailleElement(operation);
+    size_t tailleDerniers = (size_t)nbProcessus * t * sizeof(int);
+    int *derniers = NULL;
+    if (nbProcessus > 1) {
+        derniers = mmap(NULL, tailleDerniers, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    }
+    if (derniers == NULL || derniers == MAP_FAILED) {
+        scanSequentielDepuis(operation, source, data, nb, retenue);
+        return;
+    }
+
+    pid_t fils[NB_MAXI_THREADS];
+    for (int passe=1; passe<=2; passe++) {
+        for (int k=(passe == 1) ? 0 : 1; k<nbProcessus; k++) {
+            fils[k] = fork();
+            if (fils[k] > 0) continue;
+
+            // Le fils (ou le worker lui-même si le fork a échoué)
+            int debut, fin;
+            bornesBloc(nb, nbProcessus, k, &debut, &fin);
+            if (passe == 1) {
+                scanSequentielDepuis(operation, &source[debut*t], &data[debut*t], fin - debut,
+                                     (k == 0) ? retenue : NULL);
+                memcpy(&derniers[k*t], &data[(fin-1)*t], t * sizeof(int));
+            } else {
+                int retenueK[TAILLE_MAX_ELEMENT];
+                retenueBloc(operation, derniers, k, retenueK);
+                appliquerRetenue(operation, &data[debut*t], fin - debut, retenueK);
+            }
+            if (fils[k] == 0) _exit(EXIT_SUCCESS);
+        }
+        for (int k=(passe == 1) ? 0 : 1; k<nbProcessus; k++) {
+            if (fils[k] > 0) waitpid(fils[k], NULL, 0);
+        }
+    }
+    munmap(derniers, tailleDerniers);
+}
+
+/* ====================================================================== */
+/*                   Moteur historique de Hills Steel Scan                */
+/* ====================================================================== */
+
+typedef struct hills_t hills_t;
+
+struct hills_t {
+    int                operation;
+    int               *data;
+    int               *data_new;    // tableau temporaire servant pour les calculs
+    int                nb;
+    int                nbThreads;
+    int                indice;
+    pthread_barrier_t *barriere;
+};
+
+/* A l'étape e, chaque élément d'indice i >= 2^e est combiné avec l'élément
+   d'indice i - 2^e de l'étape précédente. Chaque thread traite une tranche
+   fixe d'indices et attend les autres à la fin de chaque étape.
+   ************************************************************************/
+static void *etapesHillisSteele(void *arg) {
+    hills_t *h = (hills_t *)arg;
+    int t = tailleElement(h->operation);
+    int debut, fin;
+    bornesBloc(h->nb, h->nbThreads, h->indice, &debut, &fin);
+
+    int *src = h->data, *dst = h->data_new;
+    for (long long d=1; d<h->nb; d*=2) {
+        for (int i=debut; i<fin; i++) {
+            if (i >= d) {
+                combinerElements(h->operation, &dst[i*t], &src[i*t], &src[(i-d)*t]);
+            } else {
+                memcpy(&dst[i*t], &src[i*t], t * sizeof(int));
+            }
+        }
+        pthread_barrier_wait(h->barriere);
+        int *tmp = src;
+        src = dst;
+        dst = tmp;
+    }
+    return NULL;
+}
+
+void scanHillisSteele(int operation, const int *source, int *data, int nb, int nbThreads) {
+    if (nbThreads > nb) nbThreads = nb;
+    if (nbThreads > NB_MAXI_THREADS) nbThreads = NB_MAXI_THREADS;
+    if (nbThreads < 1) nbThreads = 1;
+
+    // les étapes alternent entre "data" et un tableau temporaire: la
+    // copie de départ est négligeable devant les log2(nb) étapes
+    size_t tailleData = (size_t)nb * tailleElement(operation) * sizeof(int);
+    if (source != data) memcpy(data, source, tailleData);
+    int *data_new = malloc(tailleData);
+    if (data_new == NULL) {
+        perror("malloc");
+        return;
+    }
+
+    pthread_t Threads[NB_MAXI_THREADS];
+    hills_t hills[NB_MAXI_THREADS];
+    pthread_barrier_t barriere;
+    pthread_barrier_init(&barriere, NULL, nbThreads);
+
+    for (int k=0; k<nbThreads; k++) {
+        hills[k].operation = operation;
+        hills[k].data      = data;
+        hills[k].data_new  = data_new;
+        hills[k].nb        = nb;
+        hills[k].nbThreads = nbThreads;
+        hills[k].indice    = k;
+        hills[k].barriere  = &barriere;
+        pthread_create(&Threads[k], NULL, etapesHillisSteele, &hills[k]);
+    }
+    for (int k=0; k<nbThreads; k++) {
+        pthread_join(Threads[k], NULL);
+    }
+    pthread_barrier_destroy(&barriere);
+
+    // après un nombre impair d'étapes le résultat est dans data_new
+    int nbEtapes = 0;
+    for (long long d=1; d<nb; d*=2) nbEtapes++;
+    if (nbEtapes % 2 == 1) {
+        memcpy(data, data_new, tailleData);
+    }
+    free(data_new);
+}
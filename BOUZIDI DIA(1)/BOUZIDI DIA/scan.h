@@ -0,0 +1,24 @@
+/**
+ * scan.h
+ *
+ *  Created on: 23 déc. 2022
+ *      Author: Bouzidi Louisa et Dia Modou Ndiar
+ *
+ *  Moteurs de calcul du préfixe d'un tableau, un par stratégie d'exécution
+ *  (PLAN_SEQUENTIEL, PLAN_SIMD, ...). Tous lisent "source" et écrivent le
+ *  préfixe dans "data", qui peuvent être le même tableau; "retenue", si
+ *  elle n'est pas NULL, est le résultat qui précède data[0].
+ *  scanDistribue calcule dans des processus fils: "data" doit être en
+ *  mémoire partagée (segment shmget ou mmap MAP_SHARED).
+ */
+
+#ifndef SCAN_H_
+#define SCAN_H_
+
+int  simdDisponible(int operation);
+void scanSIMD(int operation, const int *source, int *data, int nb, const int *retenue);
+void scanBlocs(int operation, const int *source, int *data, int nb, const int *retenue, int nbThreads);
+void scanDistribue(int operation, const int *source, int *data, int nb, const int *retenue, int nbProcessus);
+void scanHillisSteele(int operation, const int *source, int *data, int nb, int nbThreads);
+
+#endif /* SCAN_H_ */
@@ -12,17 +12,50 @@
  *   ---> se clone et crée (grâce à l’appel fork) un processus fils (nommé worker)
  *   ---> Le processus fils (worker ==0) fait appel à une fonction “traitementWorker”
  *        à laquelle il fournit le PID du client qui a envoyé la requête, la taille du
- *        tableau de données déjà mis en mémoire partagée et l’opération à appliquer
+ *        tableau de données mis en mémoire partagée et l’opération à appliquer
  *        sur les données.
- *   ---> la fonction “traitementWorker” applique l'algorithme de Hills Steel Scan
- *        et crée crée plusieurs threads pour le calcul parallèle.
- *   ---> le serveur (le père) attend la fin de l’exécution du worker (son fils) pour
- *        reboucler et traiter une nouvelle requête d'un client
+ *   ---> la fonction “traitementWorker” calcule les données bloc par bloc, au fur et
+ *        à mesure de leur dépôt par le client, et demande au planificateur (planificateur.c)
+ *        la stratégie la moins coûteuse pour la taille et l'opération de la requête
+ *        (boucle séquentielle, vectorisée, blocs sur plusieurs threads ou processus,
+ *        ou l'algorithme historique de Hills Steel Scan) puis l'exécute.
+ *   ---> le serveur (le père) reboucle aussitôt pour traiter une nouvelle requête
+ *        d'un client, et récupère ses workers (ses fils) à mesure qu'ils se terminent
+ *
+ * Au démarrage, le serveur charge les plugins d'opérations du dossier DOSSIER_PLUGINS
+ * (voir plugins.c) et publie la liste des opérations disponibles dans le fichier
+ * CATALOGUE_OPERATIONS, lu par les clients et le programme de contrôle.
+ *
+ * Les requêtes REQUETE_DEPOT_DATASET et REQUETE_CALCUL_DATASET déposent puis utilisent
+ * un jeu de données nommé gardé en mémoire par le serveur (voir datasets.c): le client
+ * ne transfère alors plus ses données, seulement les résultats. Le serveur récupère ses
+ * workers terminés entre deux lectures du tube pour relâcher les jeux qu'ils utilisaient.
+ *
+ * Le serveur attend à la fois les requêtes du tube et les commandes du programme de
+ * contrôle sur la socket SOCKET_CONTROLE (voir controle.c), ce qui permet pendant son
+ * exécution de:
+ *   ---> régler le nombre maximal de workers simultanés (au-delà, les requêtes attendent
+ *        dans le tube), la limite de threads par requête et la capacité des jeux de données
+ *   ---> consulter la file d'attente et la latence des requêtes
+ *   ---> le drainer: il ne lit plus le tube, refuse les requêtes qui y attendent encore,
+ *        termine celles en cours puis s'arrête
+ *   ---> le redémarrer sans interruption: un nouveau serveur est lancé avec le tube, la
+ *        socket de contrôle, les réglages et les jeux de données de l'ancien (option -r),
+ *        l'ancien cesse de lire le tube dès que le nouveau est prêt puis termine ses
+ *        requêtes en cours
+ *
+ * Lancé avec "./serveur -f <fichierEntrée> <opération> <fichierSortie>", le serveur
+ * ne crée pas de tube: il calcule directement le fichier en mode flux (par blocs,
+ * voir flux.c), ce qui permet de traiter des fichiers plus grands que la mémoire.
  */
 
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/shm.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/ioctl.h>
+#include <poll.h>
 #include <fcntl.h>
 #include <stdio.h>
 #include <errno.h>
@@ -33,56 +66,458 @@
 #include <pthread.h>
 #include <signal.h>
 #include <sys/wait.h>
+#include <time.h>
+#include <sched.h>
 #include "conf.h"
+#include "planificateur.h"
+#include "operations.h"
+#include "plugins.h"
+#include "flux.h"
+#include "datasets.h"
+#include "controle.h"
+
+int listWorkers [NB_MAX_WORKERS];
+int nbWorkers;
+int datasetWorkers [NB_MAX_WORKERS];   // jeu de données utilisé par chaque worker, ou -1
+long long debutWorkers [NB_MAX_WORKERS];   // date de lancement de chaque worker (ns)
+
+// Etats du serveur
+// ****************
+#define SERVEUR_ACTIF     0     // lit les requêtes du tube
+#define SERVEUR_EN_DRAIN  1     // ne lit plus le tube, termine les requêtes en cours
+
+int etatServeur = SERVEUR_ACTIF;
+int maxWorkers  = NB_MAX_WORKERS;   // workers simultanés, réglable par le ctrl
+int fdread      = -1;               // tube des requêtes
+int fdControle  = -1;               // socket d'écoute du canal de contrôle
+
+// Redémarrage en cours : liaison avec le nouveau serveur et connexion du
+// programme de contrôle qui attend le résultat
+int fdPassation = -1;
+int fdClientRedemarrage = -1;
+pid_t nouveauServeur = 0;
+long long debutPassation = 0;
+
+// Réglages passés au nouveau serveur lors d'un redémarrage
+typedef struct {
+    int    maxWorkers;
+    int    threadsMax;
+    size_t capaciteDatasets;
+} reglages_t;
+
+// Statistiques publiées par la commande "statistiques"
+static struct {
+    long long nbRecues;
+    long long nbTerminees;
+    long long nbRefusees;
+    long long sommeLatence;     // ns, du lancement du worker à sa fin
+    long long derniereLatence;
+    long long maxLatence;
+} stats;
 
 void creerTube();
-int traitementWorker(int pid, int dataSize, int operation);
+void afficherTableau(const int *T, int size);
+int attendreDepot(struct shmseg *shmp, int pid, int nb);
+long long maintenantNs(void);
+void traiterRequete(struct requete *req);
+void traiterCommande(int fdClient, char *commande);
+void afficherStatistiques(int fdClient);
+void regler(int fdClient, const char *parametre, long valeur);
+void cesserAccepter(int refuserEnAttente);
+int  lancerRedemarrage(int fdClient);
+void terminerRedemarrage(void);
+void reprendreServeur(int fd);
+void fermerCanaux(void);
+void enregistrerWorker(pid_t worker, int dataset);
+static void refuserRequeteEnAttente(const struct requete *req, const char *motif);
+void libererWorkers(void);
+int depotDataset(struct shmseg *shmp, const struct requete *req, int dataset);
+struct datasetseg *ouvrirDataset(struct shmseg *shmp, const struct requete *req, int dataset);
+int traitementWorker(const struct requete *req, int dataset);
+
+static void reveil(int signal) {
+    (void)signal;
+}
 
 int main(int argc, char *argv[]) {
 
-    creerTube();  // Création du tube
-
-    // Récupération du descripteur du tube en lecture
-    // FIFO_NAME contient le nom du tube partagé entre le client et le serveur
-    // On suppose que le client et le serveur sont dans le même répertoire
-    // *********************************************************************
+    // Mode flux : le fichier de données est indiqué directement au serveur
+    // ********************************************************************
+    chargerPlugins(DOSSIER_PLUGINS);
 
-    int fdread = 0;
-    if ((fdread = open(FIFO_NAME, O_RDONLY)) == -1) {
-        fprintf(stderr, "Impossible d'ouvrir le tube en lecture: %s\n",
-                strerror(errno));
-        exit(EXIT_FAILURE);
+    if (argc == 5 && strcmp(argv[1], "-f") == 0) {
+        int operation = atoi(argv[3]);
+        if (!operationExiste(operation)) {
+            fprintf(stderr, "Numéro d'opération incorrect: %s\n", argv[3]);
+            exit(EXIT_FAILURE);
+        }
+        exit(traitementFlux(argv[2], operation, argv[4]));
     }
 
-    // boucle infinie de lecture des requêtes depuis le tube
-    // ***************************************************
-    struct requete req;
-    int numRequette = 0;
-    while (1) {
-        while (1) {
-            if (read(fdread, &req, sizeof(req)) > 0) break;
+    ecrireCatalogue(CATALOGUE_OPERATIONS);  // Publication des opérations disponibles
+
+    if (argc == 5 && strcmp(argv[1], "-r") == 0) {
+        // Redémarrage : le tube et la socket de contrôle sont hérités de
+        // l'ancien serveur, qui envoie ses réglages et ses jeux de données
+        // ******************************************************************
+        fdread     = atoi(argv[2]);
+        fdControle = atoi(argv[3]);
+        reprendreServeur(atoi(argv[4]));
+    } else {
+        calibrerPlanificateur();  // Mesure des coefficients de coût des stratégies
+
+        creerTube();  // Création du tube
+
+        // Récupération du descripteur du tube en lecture
+        // FIFO_NAME contient le nom du tube partagé entre le client et le serveur
+        // On suppose que le client et le serveur sont dans le même répertoire.
+        // Le tube est ouvert en lecture et écriture : le serveur en restant
+        // écrivain, la lecture ne voit pas de fin de fichier quand aucun client
+        // n'a ouvert le tube et l'ouverture n'attend pas de premier client.
+        // *********************************************************************
+
+        if ((fdread = open(FIFO_NAME, O_RDWR)) == -1) {
+            fprintf(stderr, "Impossible d'ouvrir le tube en lecture: %s\n",
+                    strerror(errno));
+            exit(EXIT_FAILURE);
         }
-        numRequette++;
-        printf("\n\nRequête courante : ");
-        printf("(Pid=%d, Taille=%d, OP=%d)\n", req.pid, req.dataSize, req.operation);
-
-        pid_t worker= fork();
+        fdControle = ouvrirControle(SOCKET_CONTROLE);
+    }
 
-        if(worker==0) {
-            traitementWorker(req.pid, req.dataSize, req.operation);
-            exit(EXIT_SUCCESS);
+    ecrireCatalogueDatasets(CATALOGUE_DATASETS);
+
+    // La fin d'un worker (SIGCHLD) interrompt l'attente pour le récupérer aussitôt
+    signal(SIGCHLD, reveil);
+
+    // boucle de lecture des requêtes depuis le tube et des commandes du
+    // programme de contrôle, jusqu'à la fin d'un drain
+    // ****************************************************************
+    while (etatServeur == SERVEUR_ACTIF || nbWorkers > 0) {
+        struct pollfd attente[3 + NB_CONNEXIONS_CONTROLE] = {
+            { (etatServeur == SERVEUR_ACTIF && nbWorkers < maxWorkers) ? fdread : -1, POLLIN, 0 },
+            { fdPassation, POLLIN, 0 },
+        };
+        int nbAttente = 2 + attenteControle(fdControle, &attente[2]);
+        int nbPrets = poll(attente, nbAttente, 100);
+        libererWorkers();
+
+        if (fdPassation >= 0 && maintenantNs() - debutPassation > DELAI_PASSATION * 1000000000LL) {
+            terminerRedemarrage();  // délai dépassé: échec du redémarrage
         }
+        if (nbPrets <= 0) continue;
 
-        int	status;
-        while (numRequette==10){
-            waitpid(worker, &status, 0); // Attendre le fils (worker)
-            printf("Serveur : Mon worker PID=%d s'est terminé avec success (statut: %d)\n", worker, status);
+        if (attente[1].revents != 0 && fdPassation >= 0) {
+            terminerRedemarrage();
+        }
+        // les connexions de contrôle déjà ouvertes sont servies même après
+        // la fermeture de la socket d'écoute (drain, redémarrage)
+        char commande[TAILLE_COMMANDE];
+        int fdClient;
+        while ((fdClient = lireCommande(&attente[2], nbAttente - 2, commande, sizeof(commande))) >= 0) {
+            traiterCommande(fdClient, commande);
+            if (fdControle < 0) attente[2].revents = 0;  // socket d'écoute fermée par un drain
+        }
+        if ((attente[0].revents & POLLIN) && etatServeur == SERVEUR_ACTIF) {
+            struct requete req;
+            if (read(fdread, &req, sizeof(req)) == sizeof(req)) traiterRequete(&req);
         }
-
     }
+    printf("\nServeur PID=%d arrêté: toutes ses requêtes sont terminées\n", getpid());
     return 0;
 }
 
+long long maintenantNs(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1000000000LL + t.tv_nsec;
+} //----------------------------------------------------------------------
+
+/**********************************************************************/
+/* Lancement du worker d'une requête lue dans le tube                 */
+/**********************************************************************/
+void traiterRequete(struct requete *req) {
+    stats.nbRecues++;
+    req->dataset[TAILLE_NOM_DATASET-1] = '\0';
+    printf("\n\nRequête courante : ");
+    printf("(Pid=%d, Type=%d, Taille=%d, OP=%d, Plan=%s, Threads=%d", req->pid, req->type,
+           req->dataSize, req->operation, nomPlan(req->plan), req->nbThreads);
+    if (req->type != REQUETE_CALCUL) printf(", Jeu=%s", req->dataset);
+    printf(")\n");
+
+    // un jeu déposé pendant un redémarrage ne serait pas passé au nouveau
+    // serveur, qui a déjà reçu la liste des jeux
+    if (req->type == REQUETE_DEPOT_DATASET && fdPassation >= 0) {
+        refuserRequeteEnAttente(req, "redémarrage en cours");
+        return;
+    }
+
+    // Le jeu de données de la requête est réservé avant le fork et
+    // relâché quand le worker se termine (libererWorkers)
+    int dataset = -1;
+    if (req->type == REQUETE_DEPOT_DATASET) {
+        dataset = creerDataset(req->dataset, req->dataSize);
+    } else if (req->type == REQUETE_CALCUL_DATASET) {
+        dataset = trouverDataset(req->dataset);
+    }
+    if (dataset >= 0) prendreDataset(dataset);
+
+    fflush(stdout);
+    pid_t worker= fork();
+
+    if(worker==0) {
+        signal(SIGCHLD, SIG_DFL);
+        fermerCanaux();
+        traitementWorker(req, dataset);
+        exit(EXIT_SUCCESS);
+    }
+    if (worker == -1) {
+        perror("fork");
+        if (dataset >= 0) {
+            if (req->type == REQUETE_DEPOT_DATASET) segmentDataset(dataset)->etat = DATASET_ERREUR;
+            relacherDataset(dataset);
+        }
+    } else {
+        if (dataset >= 0 && req->type == REQUETE_DEPOT_DATASET) {
+            __atomic_store_n(&segmentDataset(dataset)->pidDepot, worker, __ATOMIC_RELEASE);
+        }
+        enregistrerWorker(worker, dataset);
+    }
+    // un jeu remplacé par ce dépôt disparaît du catalogue jusqu'à la fin du
+    // dépôt, le nouveau jeu y est publié quand son worker se termine
+    if (req->type == REQUETE_DEPOT_DATASET) ecrireCatalogueDatasets(CATALOGUE_DATASETS);
+} //----------------------------------------------------------------------
+
+/**********************************************************************/
+/* Exécution d'une commande du programme de contrôle, la réponse est  */
+/* écrite sur sa connexion "fdClient"                                 */
+/**********************************************************************/
+void traiterCommande(int fdClient, char *commande) {
+    char parametre[32];
+    long valeur;
+
+    printf("\nCommande de contrôle : %s\n", commande);
+    if (strcmp(commande, "statistiques") == 0) {
+        afficherStatistiques(fdClient);
+    } else if (sscanf(commande, "regler %31s %ld", parametre, &valeur) == 2) {
+        regler(fdClient, parametre, valeur);
+    } else if (fdPassation >= 0) {
+        dprintf(fdClient, "Redémarrage en cours, commande \"%s\" refusée\n", commande);
+    } else if (etatServeur != SERVEUR_ACTIF
+               && (strcmp(commande, "drainer") == 0 || strcmp(commande, "redemarrer") == 0)) {
+        // connexion ouverte avant un drain ou un redémarrage: le tube et la
+        // socket appartiennent peut-être déjà à un nouveau serveur
+        dprintf(fdClient, "Serveur PID=%d en cours d'arrêt, commande \"%s\" refusée\n", getpid(), commande);
+    } else if (strcmp(commande, "drainer") == 0) {
+        dprintf(fdClient, "Drain du serveur PID=%d: plus de nouvelle requête, %d requête(s) en cours à terminer\n",
+                getpid(), nbWorkers);
+        cesserAccepter(TRUE);
+    } else if (strcmp(commande, "redemarrer") == 0) {
+        if (lancerRedemarrage(fdClient)) return;   // réponse à la fin du redémarrage
+    } else {
+        dprintf(fdClient, "Commande inconnue: %s\n", commande);
+    }
+    close(fdClient);
+} //----------------------------------------------------------------------
+
+void afficherStatistiques(int fdClient) {
+    int octetsEnAttente = 0;
+    if (fdread >= 0) ioctl(fdread, FIONREAD, &octetsEnAttente);
+
+    int nbJeux;
+    size_t octetsJeux, capaciteJeux;
+    etatDatasets(&nbJeux, &octetsJeux, &capaciteJeux);
+
+    dprintf(fdClient, "Serveur PID=%d (%s)\n", getpid(),
+            (etatServeur == SERVEUR_ACTIF) ? "actif" : "en drain");
+    dprintf(fdClient, "File d'attente  : %d requête(s) dans le tube, %d en cours (au plus %d workers)\n",
+            octetsEnAttente / (int)sizeof(struct requete), nbWorkers, maxWorkers);
+    dprintf(fdClient, "Requêtes        : %lld reçues, %lld terminées, %lld refusées\n",
+            stats.nbRecues, stats.nbTerminees, stats.nbRefusees);
+    dprintf(fdClient, "Latence         : moyenne %.3f ms, dernière %.3f ms, maximum %.3f ms\n",
+            (stats.nbTerminees > 0) ? stats.sommeLatence / 1e6 / stats.nbTerminees : 0.0,
+            stats.derniereLatence / 1e6, stats.maxLatence / 1e6);
+    if (lireThreadsMax() > 0) {
+        dprintf(fdClient, "Threads         : au plus %d par requête\n", lireThreadsMax());
+    } else {
+        dprintf(fdClient, "Threads         : choix du planificateur\n");
+    }
+    dprintf(fdClient, "Jeux de données : %d, %.1f Mio sur une capacité de %.1f Mio\n",
+            nbJeux, octetsJeux / 1048576.0, capaciteJeux / 1048576.0);
+} //----------------------------------------------------------------------
+
+/* Réglages modifiables pendant l'exécution. Ils s'appliquent aux
+   requêtes suivantes: chaque worker hérite des réglages à son fork.
+   ************************************************************************/
+void regler(int fdClient, const char *parametre, long valeur) {
+    if (strcmp(parametre, "workers") == 0 && valeur >= 1 && valeur <= NB_MAX_WORKERS) {
+        maxWorkers = (int)valeur;
+        dprintf(fdClient, "Au plus %d workers simultanés\n", maxWorkers);
+    } else if (strcmp(parametre, "threads") == 0 && valeur >= 0 && valeur <= NB_MAXI_THREADS) {
+        fixerThreadsMax((int)valeur);
+        dprintf(fdClient, "Au plus %d thread(s) par requête (0: choix du planificateur)\n", lireThreadsMax());
+    } else if (strcmp(parametre, "cache") == 0 && valeur >= 0) {
+        fixerCapaciteDatasets((size_t)valeur << 20);
+        ecrireCatalogueDatasets(CATALOGUE_DATASETS);
+        dprintf(fdClient, "Capacité des jeux de données: %ld Mio\n", valeur);
+    } else {
+        dprintf(fdClient, "Réglage incorrect: workers (1 à %d), threads (0 à %d) ou cache (Mio)\n",
+                NB_MAX_WORKERS, NB_MAXI_THREADS);
+    }
+} //----------------------------------------------------------------------
+
+/* Refus d'une requête sans lancer de worker (requête restée dans le tube
+   lors d'un drain, dépôt pendant un redémarrage)
+   ************************************************************************/
+static void refuserRequeteEnAttente(const struct requete *req, const char *motif) {
+    int shmid = shmget(req->pid, 0, 0644);
+    if (shmid == -1) return;
+    struct shmseg *shmp = shmat(shmid, NULL, 0);
+    if (shmp == (void *) -1) return;
+    __atomic_store_n(&shmp->status, ERREUR_REQUETE, __ATOMIC_RELEASE);
+    shmdt(shmp);
+    stats.nbRefusees++;
+    printf("Requête du client %d refusée: %s\n", req->pid, motif);
+} //----------------------------------------------------------------------
+
+/**********************************************************************/
+/* Fin de l'acceptation des requêtes (drain ou fin d'un redémarrage). */
+/* Pour un drain, le tube et la socket sont supprimés pour que les    */
+/* nouveaux clients échouent aussitôt, et les requêtes déjà écrites   */
+/* dans le tube sont refusées. Après un redémarrage, ils restent au   */
+/* nouveau serveur.                                                   */
+/**********************************************************************/
+void cesserAccepter(int refuserEnAttente) {
+    etatServeur = SERVEUR_EN_DRAIN;
+    if (refuserEnAttente) {
+        unlink(FIFO_NAME);
+        unlink(SOCKET_CONTROLE);
+        struct requete req;
+        fcntl(fdread, F_SETFL, O_NONBLOCK);
+        while (read(fdread, &req, sizeof(req)) == sizeof(req)) refuserRequeteEnAttente(&req, "serveur en cours d'arrêt");
+    }
+    if (fdControle >= 0) close(fdControle);
+    close(fdread);
+    fdControle = -1;
+    fdread     = -1;
+} //----------------------------------------------------------------------
+
+/**********************************************************************/
+/* Redémarrage sans interruption: lancement du nouveau serveur avec   */
+/* le tube et la socket de contrôle, puis envoi des réglages et des   */
+/* jeux de données. L'ancien serveur continue de traiter les requêtes */
+/* jusqu'à ce que le nouveau soit prêt (terminerRedemarrage).         */
+/* Renvoie TRUE si la réponse au ctrl est différée.                   */
+/**********************************************************************/
+int lancerRedemarrage(int fdClient) {
+    // seuls les jeux prêts sont passés au nouveau serveur: un dépôt en
+    // cours serait perdu
+    int nbDepots = depotsEnCours();
+    if (nbDepots > 0) {
+        dprintf(fdClient, "Redémarrage refusé: %d dépôt(s) de jeu de données en cours, réessayez à leur fin\n",
+                nbDepots);
+        return FALSE;
+    }
+
+    int liaison[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, liaison) == -1) {
+        dprintf(fdClient, "Redémarrage impossible: %s\n", strerror(errno));
+        return FALSE;
+    }
+    fcntl(liaison[0], F_SETFD, FD_CLOEXEC);
+
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        char tube[16], controle[16], passation[16];
+        snprintf(tube, sizeof(tube), "%d", fdread);
+        snprintf(controle, sizeof(controle), "%d", fdControle);
+        snprintf(passation, sizeof(passation), "%d", liaison[1]);
+        execl("./serveur", "serveur", "-r", tube, controle, passation, NULL);
+        perror("Lancement du nouveau serveur");
+        _exit(EXIT_FAILURE);
+    }
+    close(liaison[1]);
+    if (pid == -1) {
+        dprintf(fdClient, "Redémarrage impossible: %s\n", strerror(errno));
+        close(liaison[0]);
+        return FALSE;
+    }
+
+    int nbJeux;
+    size_t octetsJeux;
+    reglages_t reglages;
+    reglages.maxWorkers = maxWorkers;
+    reglages.threadsMax = lireThreadsMax();
+    etatDatasets(&nbJeux, &octetsJeux, &reglages.capaciteDatasets);
+    if (write(liaison[0], &reglages, sizeof(reglages)) == sizeof(reglages)) {
+        exporterDatasets(liaison[0]);
+    }
+    shutdown(liaison[0], SHUT_WR);
+
+    printf("\nRedémarrage : nouveau serveur lancé sous le PID %d\n", pid);
+    fdPassation         = liaison[0];
+    fdClientRedemarrage = fdClient;
+    nouveauServeur      = pid;
+    debutPassation      = maintenantNs();
+    return TRUE;
+} //----------------------------------------------------------------------
+
+/* Le nouveau serveur a signalé qu'il était prêt (ou s'est arrêté, ou a
+   dépassé DELAI_PASSATION): l'ancien cesse de lire le tube, ou continue
+   seul si le redémarrage a échoué
+   ************************************************************************/
+void terminerRedemarrage(void) {
+    char pret = 0;
+    struct pollfd attente = { fdPassation, POLLIN, 0 };
+    int reussi = poll(&attente, 1, 0) == 1 && read(fdPassation, &pret, 1) == 1 && pret == TRUE;
+    close(fdPassation);
+    fdPassation = -1;
+
+    if (reussi) {
+        dprintf(fdClientRedemarrage, "Nouveau serveur prêt sous le PID %d, l'ancien (PID %d) termine ses %d requête(s) en cours\n",
+                nouveauServeur, getpid(), nbWorkers);
+        cesserAccepter(FALSE);
+    } else {
+        kill(nouveauServeur, SIGKILL);
+        waitpid(nouveauServeur, NULL, 0);
+        dprintf(fdClientRedemarrage, "Echec du redémarrage: le serveur PID %d continue\n", getpid());
+    }
+    close(fdClientRedemarrage);
+    fdClientRedemarrage = -1;
+} //----------------------------------------------------------------------
+
+/**********************************************************************/
+/* Démarrage d'un serveur lancé par "redemarrer" : réception des      */
+/* réglages et des jeux de données de l'ancien serveur sur "fd",      */
+/* calibrage, puis signal "prêt"                                      */
+/**********************************************************************/
+void reprendreServeur(int fd) {
+    reglages_t reglages;
+    int nbJeux = 0;
+    if (read(fd, &reglages, sizeof(reglages)) == sizeof(reglages)) {
+        maxWorkers = reglages.maxWorkers;
+        fixerThreadsMax(reglages.threadsMax);
+        fixerCapaciteDatasets(reglages.capaciteDatasets);
+        nbJeux = importerDatasets(fd);
+    }
+    calibrerPlanificateur();
+
+    printf("\nServeur redémarré sous le PID %d: %d jeu(x) de données repris\n", getpid(), nbJeux);
+    char pret = TRUE;
+    if (write(fd, &pret, 1) != 1) perror("Passation");
+    close(fd);
+} //----------------------------------------------------------------------
+
+/* Un worker n'utilise ni le tube ni le canal de contrôle
+   ************************************************************************/
+void fermerCanaux(void) {
+    if (fdread >= 0) close(fdread);
+    if (fdControle >= 0) close(fdControle);
+    if (fdPassation >= 0) close(fdPassation);
+    if (fdClientRedemarrage >= 0) close(fdClientRedemarrage);
+    fermerConnexions();
+} //----------------------------------------------------------------------
+
 /**********************************************************************/
 /* Fonction permettant de créer un tube nommé qui sera utilisé        */
 /* par des processus clients en écriture et par le serveur en lecture */
@@ -105,13 +540,181 @@ void creerTube(void) {
     }
 } //----------------------------------------------------------------------
 
-int traitementWorker(int pid, int dataSize, int operation) {
+/**********************************************************************/
+/* Affichage d'un tableau, limité à ses NB_MAX_AFFICHAGE premières    */
+/* valeurs                                                            */
+/**********************************************************************/
+void afficherTableau(const int *T, int size) {
+    int nbAffiches = (size > NB_MAX_AFFICHAGE) ? NB_MAX_AFFICHAGE : size;
+    printf("[");
+    for (int i=0; i<nbAffiches; i++) {
+        printf("%d", T[i]);
+        if (i!=size-1) printf(", ");
+    }
+    if (nbAffiches < size) printf("... (%d valeurs)", size);
+    printf("]\n");
+}//-------------------------------------
+
+/**********************************************************************/
+/* Attente active que le client ait déposé au moins "nb" éléments.    */
+/* Renvoie FALSE si le client n'existe plus.                          */
+/**********************************************************************/
+int attendreDepot(struct shmseg *shmp, int pid, int nb) {
+    long tours = 0;
+    while (__atomic_load_n(&shmp->nbDeposes, __ATOMIC_ACQUIRE) < nb) {
+        if (++tours % 100000 == 0 && kill(pid, 0) == -1 && errno == ESRCH) {
+            return FALSE;
+        }
+        sched_yield();
+    }
+    return TRUE;
+}//-------------------------------------
+
+/**********************************************************************/
+/* Suivi des workers en cours et du jeu de données de chacun          */
+/**********************************************************************/
+void enregistrerWorker(pid_t worker, int dataset) {
+    listWorkers[nbWorkers]    = worker;
+    datasetWorkers[nbWorkers] = dataset;
+    debutWorkers[nbWorkers]   = maintenantNs();
+    nbWorkers++;
+}//-------------------------------------
+
+/* Récupération, sans attendre, des workers terminés. Seuls les PID de
+   listWorkers sont attendus: le nouveau serveur d'un redémarrage est aussi
+   un fils, mais il doit survivre à l'ancien (voir terminerRedemarrage)
+   ************************************************************************/
+void libererWorkers(void) {
+    int status, catalogueModifie = FALSE;
+    long long maintenant = maintenantNs();
+    int i = 0;
+    while (i < nbWorkers) {
+        pid_t worker = listWorkers[i];
+        if (waitpid(worker, &status, WNOHANG) != worker) {
+            i++;
+            continue;
+        }
+        long long latence = maintenant - debutWorkers[i];
+        stats.nbTerminees++;
+        stats.sommeLatence   += latence;
+        stats.derniereLatence = latence;
+        if (latence > stats.maxLatence) stats.maxLatence = latence;
+        if (datasetWorkers[i] >= 0) {
+            // un worker de dépôt terminé sans rendre le jeu (signal, plantage):
+            // le jeu est en erreur, ce qui libère les requêtes qui l'attendent
+            struct datasetseg *d = segmentDataset(datasetWorkers[i]);
+            int enDepot = DATASET_EN_DEPOT;
+            if (d->pidDepot == worker) {
+                __atomic_compare_exchange_n(&d->etat, &enDepot, DATASET_ERREUR, FALSE,
+                                            __ATOMIC_RELEASE, __ATOMIC_RELAXED);
+            }
+            relacherDataset(datasetWorkers[i]);
+            catalogueModifie = TRUE;
+        }
+        nbWorkers--;
+        listWorkers[i]    = listWorkers[nbWorkers];
+        datasetWorkers[i] = datasetWorkers[nbWorkers];
+        debutWorkers[i]   = debutWorkers[nbWorkers];
+        printf("Serveur : Mon worker PID=%d s'est terminé (statut: %d)\n", worker, status);
+    }
+    // après un drain ou un redémarrage, le catalogue appartient au nouveau
+    // serveur (ou n'a plus lieu d'être): l'ancien ne le réécrit plus
+    if (catalogueModifie && etatServeur == SERVEUR_ACTIF) ecrireCatalogueDatasets(CATALOGUE_DATASETS);
+}//-------------------------------------
+
+/* Refus d'une requête: le client est prévenu par le statut ERREUR_REQUETE
+   ************************************************************************/
+static void refuserRequete(struct shmseg *shmp, const char *motif) {
+    fprintf(stderr, "Requête refusée: %s\n", motif);
+    __atomic_store_n(&shmp->status, ERREUR_REQUETE, __ATOMIC_RELEASE);
+}//-------------------------------------
+
+/* Le segment "shmid" du client peut-il contenir "nbEntiers" entiers ?
+   ************************************************************************/
+static int segmentSuffisant(int shmid, long long nbEntiers) {
+    struct shmid_ds infos;
+    return nbEntiers >= 0 && shmctl(shmid, IPC_STAT, &infos) == 0
+           && TAILLE_SEGMENT(nbEntiers) <= infos.shm_segsz;
+}//-------------------------------------
+
+/**********************************************************************/
+/* Worker d'une requête REQUETE_DEPOT_DATASET: copie des "nbValeurs"  */
+/* entiers déposés par le client dans le jeu de données, bloc par     */
+/* bloc, puis passage du jeu dans l'état DATASET_PRET.                */
+/**********************************************************************/
+int depotDataset(struct shmseg *shmp, const struct requete *req, int dataset) {
+    if (dataset < 0) {
+        refuserRequete(shmp, "jeu de données non créé");
+        return 1;
+    }
+    struct datasetseg *d = segmentDataset(dataset);
+    for (int premier=0; premier<req->dataSize; premier+=TAILLE_BLOC_PIPELINE) {
+        int nb = (req->dataSize - premier < TAILLE_BLOC_PIPELINE) ? req->dataSize - premier : TAILLE_BLOC_PIPELINE;
+        if (!attendreDepot(shmp, req->pid, premier + nb)) {
+            fprintf(stderr, "Client %d disparu pendant le dépôt du jeu %s\n", req->pid, req->dataset);
+            __atomic_store_n(&d->etat, DATASET_ERREUR, __ATOMIC_RELEASE);
+            return 1;
+        }
+        memcpy(&d->data[premier], &shmp->data[premier], (size_t)nb * sizeof(int));
+        __atomic_store_n(&shmp->nbCalcules, premier + nb, __ATOMIC_RELEASE);
+    }
+    __atomic_store_n(&d->etat, DATASET_PRET, __ATOMIC_RELEASE);
+    printf("\nJeu de données \"%s\" déposé : %d valeurs\n", req->dataset, req->dataSize);
+    __atomic_store_n(&shmp->status, FIN_REMISE_RESULTATS, __ATOMIC_RELEASE);
+    return 0;
+}//-------------------------------------
+
+/**********************************************************************/
+/* Worker d'une requête REQUETE_CALCUL_DATASET: attente de la fin du  */
+/* dépôt du jeu, vérification de sa taille puis protection en lecture */
+/* seule. Renvoie le segment du jeu, ou NULL si la requête est        */
+/* refusée.                                                           */
+/**********************************************************************/
+struct datasetseg *ouvrirDataset(struct shmseg *shmp, const struct requete *req, int dataset) {
+    if (dataset < 0) {
+        refuserRequete(shmp, "jeu de données inconnu");
+        return NULL;
+    }
+    // attente de la fin du dépôt, tant que son worker est là (le serveur
+    // marque aussi le jeu en erreur s'il récupère ce worker avant la fin)
+    struct datasetseg *d = segmentDataset(dataset);
+    while (__atomic_load_n(&d->etat, __ATOMIC_ACQUIRE) == DATASET_EN_DEPOT) {
+        int pidDepot = __atomic_load_n(&d->pidDepot, __ATOMIC_ACQUIRE);
+        if (pidDepot != 0 && kill(pidDepot, 0) == -1 && errno == ESRCH) break;
+        usleep(1000);
+    }
+    if (__atomic_load_n(&d->etat, __ATOMIC_ACQUIRE) != DATASET_PRET) {
+        refuserRequete(shmp, "le dépôt du jeu de données a échoué");
+        return NULL;
+    }
+    if (!operationExiste(req->operation) || d->nbValeurs != req->dataSize * tailleElement(req->operation)) {
+        refuserRequete(shmp, "opération inconnue ou taille du jeu incompatible");
+        return NULL;
+    }
+    // le jeu est partagé entre les requêtes: un worker ne doit jamais le modifier
+    mprotect(d, octetsDataset(dataset), PROT_READ);
+    return d;
+}//-------------------------------------
+
+int traitementWorker(const struct requete *req, int dataset) {
+
+    int pid = req->pid;
+    int dataSize = req->dataSize;
+    int operation = req->operation;
+
+    // Une requête restée longtemps dans le tube a pu être abandonnée par son
+    // client: inutile de s'attacher à son segment et de faire les calculs
+    if (kill(pid, 0) == -1 && errno == ESRCH) {
+        fprintf(stderr, "Client %d disparu avant la prise en charge de sa requête\n", pid);
+        return 1;
+    }
 
     // Etape1 : Obtenir l'id du segment de mémoire partagé en appelant l'appel système
-    // shmget() en lui fournissant le PIP du client comme clé
+    // shmget() en lui fournissant le PIP du client comme clé. La taille du segment
+    // est fixée par le client, on passe donc une taille nulle.
     int shmid;
     struct shmseg *shmp;
-    shmid = shmget(pid, sizeof(struct shmseg), 0644);
+    shmid = shmget(pid, 0, 0644);
     if (shmid == -1) {
         perror("Shared memory");
         return 1;
@@ -124,142 +727,124 @@ int traitementWorker(int pid, int dataSize, int operation) {
         perror("Shared memory attach");
         return 1;
     }
+    __atomic_store_n(&shmp->pidWorker, getpid(), __ATOMIC_RELEASE);
+
+    // La taille annoncée dans la requête ne doit pas dépasser le segment du
+    // client, dans lequel le worker lit les données et écrit les résultats
+    long long nbAnnonces = (req->type == REQUETE_DEPOT_DATASET)
+                           ? dataSize : (long long)dataSize * tailleElement(operation);
+    if (!segmentSuffisant(shmid, nbAnnonces)) {
+        refuserRequete(shmp, "taille annoncée incompatible avec le segment du client");
+        if (req->type == REQUETE_DEPOT_DATASET && dataset >= 0) {
+            __atomic_store_n(&segmentDataset(dataset)->etat, DATASET_ERREUR, __ATOMIC_RELEASE);
+        }
+        shmdt(shmp);
+        return 1;
+    }
 
-    // Etape3 : Faire les calculs sur les données du client et lui rendre le résultat
+    // Un dépôt de jeu de données n'est qu'une copie, sans calcul. Pour un calcul
+    // sur un jeu déjà déposé, les moteurs lisent directement le jeu (en lecture
+    // seule) et écrivent le préfixe dans le segment du client, sans recopie.
+    // ****************************************************************************
+    struct datasetseg *source = NULL;
+    if (req->type == REQUETE_DEPOT_DATASET) {
+        int retour = depotDataset(shmp, req, dataset);
+        shmdt(shmp);
+        return retour;
+    }
+    if (req->type == REQUETE_CALCUL_DATASET) {
+        source = ouvrirDataset(shmp, req, dataset);
+        if (source == NULL) {
+            shmdt(shmp);
+            return 1;
+        }
+    }
+    // Etape3 : Choisir le plan d'exécution, faire les calculs directement dans le
+    // segment du client et lui rendre le résultat avec les métriques de la requête.
+    // Pour une opération associative, chaque bloc de TAILLE_BLOC_PIPELINE éléments
+    // est calculé dès que le client l'a déposé, avec la retenue du bloc précédent,
+    // puis rendu au client qui peut le récupérer sans attendre les blocs suivants.
     // ******************************************************************************
 
     int * data = &shmp->data[0];
-    int data_new[NB_MAX_VALEURS];       // tableau temporairement servant pour les calculs
-    pthread_t Threads[NB_MAXI_THREADS];
-
-    typedef struct hills_t hills_t;
-
-    struct hills_t {
-        int etape;
-        int indice;
-    };
-
-    void afficherTableau(int *T, int size) {
-        printf("[");
-        for (int i=0; i<size; i++) {
-            printf("%d", T[i]);
-            if (i!=size-1) printf(", ");
-        }
-        printf("]\n");
-    }//-------------------------------------
-
-    int pgcd(int a, int b) {
-        while (a!=b) {
-            if (a>b) {
-                a = a-b;
-            } else {
-                b = b-a;
-            }
-        }
-        return a;
-    }//-------------------------------------
-
-    /* Fonction de claul selon l'agorithme de Hills Steel Scan
-      qui est exécutée par chaque thread pour effectuer une
-      calcul sur un élément d'indice i et un autre d'indice
-      égale à  i - 2 à la puissance l'étape
-      ************************************************************/
-    void *calcul(void*arg) {
-
-        hills_t *hills = (hills_t *)arg;
-        int i = hills->indice;
-        int e = hills->etape;
-        int i1 = (int)(i-pow(2, e));
-
-        switch (operation) {
-        case ADDITION: {
-            data_new[i] = data[i] + data[i1];
-            break;
-        }
-        case SOUSTRACTION: {
-            data_new[i] = data[i] - data[i1];
-            break;
-        }
-        case MULTIPLICATION: {
-            data_new[i] = data[i] * data[i1];
-            break;
-        }
-        case MAXIMUM: {
-            data_new[i] = (data[i] > data[i1]) ? data[i] : data[i1];
-            break;
-        }
-        case MINIMUM: {
-            data_new[i] = (data[i] < data[i1]) ? data[i] : data[i1];
-            break;
-        }
-        case PGCD: {
-            data_new[i] = pgcd(data[i], data[i1]);
-            break;
-        }
-        }
-
-        printf("\n  --> indice=%d data[%d]=data[%d] + data[%d]=%d",i,i,i,i1,data_new[i]);
-        printf("= %d + %d ", data[i], data[i1]);
-        free(hills);
-        return NULL;
-    } //--------------------------------------------------------------------------------
-
-    // Récupèration des données depuis la mémoire partagée
-    for (int i=0; i<dataSize; i++) {
-        data_new[i] = shmp->data[i];
+    int t = tailleElement(operation);
+    int nbEntiers = dataSize * t;   // dataSize est un nombre d'éléments
+
+    if (!operationExiste(operation)) {
+        fprintf(stderr, "Opération %d inconnue, données rendues sans calcul\n", operation);
+        shmp->plan = PLAN_AUTO;
+        __atomic_store_n(&shmp->nbCalcules, dataSize, __ATOMIC_RELEASE);
+        __atomic_store_n(&shmp->status, FIN_REMISE_RESULTATS, __ATOMIC_RELEASE);
+        shmdt(shmp);
+        return 1;
     }
 
-    printf("\nDonnées de départ : ");
-    afficherTableau(data, dataSize);
-
-    // calcul  du nombre maximum d'étapes de l'agorithme de hills steel scan
-    unsigned int nbEtapes;
-    nbEtapes = log2(dataSize);
-    if (pow(2,nbEtapes) <dataSize) {
-        nbEtapes=nbEtapes+1;
+    // Le plan est choisi pour toute la requête, puis la taille des blocs du
+    // pipeline en dépend:
+    //   ---> sans associativité (ou avec le plan historique) le préfixe ne peut
+    //        pas être découpé: on attend tout le dépôt en un seul bloc
+    //   ---> un plan parallèle relance ses threads ou processus à chaque bloc:
+    //        au plus NB_BLOCS_PIPELINE_PARALLELE blocs pour amortir ce coût
+    //   ---> sinon, des blocs de TAILLE_BLOC_PIPELINE éléments
+    // Le planificateur compte le lancement des threads ou processus d'un
+    // plan parallèle une fois par bloc.
+    int tailleParallele = (dataSize + NB_BLOCS_PIPELINE_PARALLELE - 1) / NB_BLOCS_PIPELINE_PARALLELE;
+    if (tailleParallele < TAILLE_BLOC_PIPELINE) tailleParallele = TAILLE_BLOC_PIPELINE;
+    int nbBlocsParallele = (dataSize > 0) ? (dataSize + tailleParallele - 1) / tailleParallele : 1;
+    plan_t plan = choisirPlan(operation, dataSize, req->plan, req->nbThreads, nbBlocsParallele);
+
+    int taillePipeline = TAILLE_BLOC_PIPELINE;
+    if (plan.strategie == PLAN_HILLIS_STEELE) {
+        taillePipeline = dataSize;
+    } else if (plan.strategie == PLAN_BLOCS || plan.strategie == PLAN_DISTRIBUE) {
+        taillePipeline = tailleParallele;
     }
-    printf ("\nNombre de valeurs de données = %d et nombre d'étapes = %d\n", dataSize, nbEtapes);
-
-    // boucle de calcul selon l'algorithme de Hills Steel Scan
-    for (int etape=0; etape<=nbEtapes; etape++) {
-        sleep(1);
-        printf("\nEtape %d  ========================================", etape);
-
-        // pour chaque étape on parcour le tableau des données en commençant
-        // par un indique égale à 2 puissance l'étape
-        for (int i=(int)pow(2,etape); i<dataSize; i++ ) {
-            hills_t *hills  = malloc(sizeof(hills_t));
-            hills->etape   = etape;
-            hills->indice  = i;
-            pthread_create(&Threads[i], NULL, calcul, hills);
+    if (taillePipeline > dataSize) taillePipeline = dataSize;
+    if (taillePipeline < 1) taillePipeline = 1;
+
+    printf("\nPlan d'exécution : %s, %d thread(s), blocs de %d éléments, coût estimé %.0f ns\n",
+           nomPlan(plan.strategie), plan.nbThreads, taillePipeline, plan.cout);
+
+    long long dureeCalcul = 0;
+    int retenue[TAILLE_MAX_ELEMENT];
+    for (int premier=0; premier<dataSize; premier+=taillePipeline) {
+        int nb = (dataSize - premier < taillePipeline) ? dataSize - premier : taillePipeline;
+        if (source == NULL && !attendreDepot(shmp, pid, premier + nb)) {
+            fprintf(stderr, "Client %d disparu pendant le dépôt des données\n", pid);
+            shmdt(shmp);
+            return 1;
         }
-
-        // j'attends la fin de l'étape pour commencer l'étape suivante
-        for (int i=pow(2, etape); i<dataSize; i++ ) {
-            pthread_join(Threads[i], NULL);
+        const int *valeurs = (source != NULL) ? source->data : data;
+        if (premier == 0) {
+            printf("\nDonnées de départ : ");
+            afficherTableau(valeurs, nbEntiers);
         }
 
-        // on met les données qui viennent d'être cacluées dans le
-        // tableau data de sorte à ce qu'elle soit prises en compte
-        // dans étape suivante
-        for (int k=0; k<dataSize; k++) {
-            data[k] = data_new[k];
-        }
+        struct timespec debut, fin;
+        clock_gettime(CLOCK_MONOTONIC, &debut);
+        executerPlan(&plan, operation, &valeurs[premier*t], &data[premier*t], nb,
+                     (premier > 0) ? retenue : NULL);
+        clock_gettime(CLOCK_MONOTONIC, &fin);
+        dureeCalcul += (fin.tv_sec - debut.tv_sec) * 1000000000LL + (fin.tv_nsec - debut.tv_nsec);
 
-        printf("\n\nCaclul intermédiaire : ");
-        afficherTableau(data_new, dataSize);
+        memcpy(retenue, &data[(premier + nb - 1) * t], t * sizeof(int));
+        __atomic_store_n(&shmp->nbCalcules, premier + nb, __ATOMIC_RELEASE);
     }
 
     printf("\n\nRésultats final \n");
     printf("******************************************************\n");
-    afficherTableau(data, dataSize);
+    afficherTableau(data, nbEntiers);
     printf("******************************************************\n");
 
+    shmp->plan        = plan.strategie;
+    shmp->nbThreads   = plan.nbThreads;
+    shmp->dureeCalcul = dureeCalcul;
+
     //***********************************************************************************************************
     // on indique au client que les calculs sont terminés et que le résultat
     // est disponible en mémoire partagée en mettant le champ complete à 2
     // ********************************************************************
-    shmp->status = FIN_REMISE_RESULTATS;
+    __atomic_store_n(&shmp->status, FIN_REMISE_RESULTATS, __ATOMIC_RELEASE);
 
     // Détacher le segment de mémoire partagé et on reboucle pour attendre une autre requête
     // ***********************************************************************************
@@ -270,6 +855,3 @@ int traitementWorker(int pid, int dataSize, int operation) {
     }
     return 0;
 }
-
-
-